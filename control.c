@@ -0,0 +1,122 @@
+/*
+ * Control socket for the relay daemon
+ * see control.h
+ */
+
+#define _GNU_SOURCE /* accept4() */
+#include <errno.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "logging.h"
+#include "control.h"
+
+/* returns the listening socket, or -1 on error */
+int
+control_open(const char *path)
+{
+    struct sockaddr_un addr;
+
+    if (strlen(path) >= sizeof (addr.sun_path)) {
+        lwsl_err("control socket path too long : %s\n", path);
+        return -1;
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        lwsl_err("control socket() failed : %s\n", strerror(errno));
+        return -1;
+    }
+
+    memset(&addr, 0, sizeof (addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+    unlink(path); /* left over from a previous run */
+
+    if (bind(fd, (struct sockaddr *) &addr, sizeof (addr)) < 0
+        || listen(fd, 4) < 0) {
+        lwsl_err("control socket %s : %s\n", path, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+    lwsl_info("control socket listening on %s\n", path);
+    return fd;
+}
+
+/* accept one client, returns its non-blocking socket or -1,
+ * the caller polls it until the command line can be read */
+int
+control_accept(int listen_fd)
+{
+    return accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+}
+
+/* read the command line of a client, never waits,
+ * returns 1 with the command in cmd, 0 when it is not there yet,
+ * -1 when the client went away (the socket is closed) */
+int
+control_read(int client_fd, char *cmd, size_t len)
+{
+    ssize_t n = recv(client_fd, cmd, len - 1, MSG_DONTWAIT);
+
+    if (n < 0 && (EAGAIN == errno || EWOULDBLOCK == errno || EINTR == errno))
+        return 0;
+    if (n <= 0) {
+        close(client_fd);
+        return -1;
+    }
+    cmd[n] = '\0';
+    cmd[strcspn(cmd, "\r\n")] = '\0';
+    return 1;
+}
+
+static void
+control_vsend(int client_fd, const char *format, va_list ap)
+{
+    char buf[256];
+
+    int n = vsnprintf(buf, sizeof (buf), format, ap);
+
+    if (n > (int) sizeof (buf) - 1)
+        n = sizeof (buf) - 1;
+    if (n > 0 && write(client_fd, buf, n) != n)
+        lwsl_debug("control reply short write\n");
+}
+
+/* send one line, the client stays connected */
+void
+control_send(int client_fd, const char *format, ...)
+{
+    va_list ap;
+
+    va_start(ap, format);
+    control_vsend(client_fd, format, ap);
+    va_end(ap);
+}
+
+/* send the last reply line and close the client */
+void
+control_reply(int client_fd, const char *format, ...)
+{
+    va_list ap;
+
+    va_start(ap, format);
+    control_vsend(client_fd, format, ap);
+    va_end(ap);
+    close(client_fd);
+}
+
+void
+control_close(int listen_fd, const char *path)
+{
+    if (listen_fd < 0)
+        return;
+    close(listen_fd);
+    unlink(path);
+}
@@ -0,0 +1,39 @@
+/*
+ * File:   control.h
+ * Control socket for the relay daemon (-S)
+ *
+ * A unix stream socket, one command line per connection,
+ * the reply (the last line is OK/ERR), then the connection is closed.
+ * Clients are non-blocking : the daemon polls them with its other fds
+ * and reads a command only when it is there, a client never stalls it.
+ *
+ * $ echo off | socat - UNIX-CONNECT:/run/switch_relay.sock
+ */
+
+#ifndef CONTROL_H
+#define	CONTROL_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+
+#define CONTROL_CMD_LEN 64
+#define CONTROL_TIMEOUT_MS 100 /* max time a client may take to send its command */
+#define CONTROL_MAX_CLIENTS 4 /* clients waiting for their command line */
+
+int control_open(const char *path);
+int control_accept(int listen_fd);
+int control_read(int client_fd, char *cmd, size_t len);
+void control_send(int client_fd, const char *format, ...)
+        __attribute__((format(printf, 2, 3)));
+void control_reply(int client_fd, const char *format, ...)
+        __attribute__((format(printf, 2, 3)));
+void control_close(int listen_fd, const char *path);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* CONTROL_H */
@@ -0,0 +1,135 @@
+/*
+ * Board driver layer, the generic part
+ * see driver.h
+ */
+
+#include <assert.h>
+#include "logging.h"
+#include "driver.h"
+
+static const ios_driver_t * const drivers[DEVICE_BRAND_LAST] = {
+    [ABACOM] = &ch341a_driver,
+    [ELOMAX] = &elomax_driver,
+    [HIDRAW] = &hidraw_driver,
+};
+
+int
+IO_open_device(ios_device_t *h)
+{
+    assert(h);
+    assert(h->device_brand < DEVICE_BRAND_LAST);
+    assert(!h->device_open);
+
+    h->driver = drivers[h->device_brand];
+    h->outputs = h->driver->outputs;
+
+    if (h->driver->probe(h))
+        return -1;
+
+    h->device_open = 1;
+    h->output_pending = 1;
+    return 0;
+}
+
+int
+IO_setup_device(ios_device_t *h)
+{
+    assert(h->device_open);
+
+    if (h->driver->setup && h->driver->setup(h)) {
+        lwsl_warn("%s : setup failed\n", h->driver->name);
+        IO_close_device(h);
+        h->output_pending = 1;
+        return -1;
+    }
+
+    assert(h->outputs > 0 && h->outputs <= IOS_MAX_OUTPUTS);
+    h->output_mask = (1u << h->outputs) - 1;
+
+    h->driver->encode(h, 0, &h->off_frame);
+
+    lwsl_info("%s : %d outputs, %s%s\n", h->driver->name, h->outputs,
+              h->driver->atomic_mask ? "atomic mask" : "relay by relay",
+              h->fake_node ? ", fake device node" : "");
+    return 0;
+}
+
+static int
+IO_write_result(ios_device_t *h, int r, uint32_t mask)
+{
+    if (IOS_WRITE_PREEMPTED == r) {
+        /* abandoned half way, the all-off frame will overwrite it */
+        h->output_pending = 1;
+        return -2;
+    }
+    if (IOS_WRITE_OK != r) {
+        lwsl_notice("%s : write failed, device closed\n", h->driver->name);
+        IO_close_device(h);
+        h->output_pending = 1;
+        return -1;
+    }
+
+    /* Remember the status */
+    h->outputbits = mask;
+    h->output_pending = 0;
+    return 0;
+}
+
+/* Actual communication with the device and saving the status */
+int
+IO_write(ios_device_t *h, uint32_t mask)
+{
+    assert(h);
+    mask &= h->output_mask;
+    static ios_frame_t frame;
+
+    if (!h->device_open) {
+        h->output_pending = 1;
+        return -1;
+    }
+
+    h->driver->encode(h, mask, &frame);
+    return IO_write_result(h, h->driver->write(h, &frame, 1), mask);
+}
+
+/* Hot standby path : send the precomputed all-off frame, no encoding, no logging */
+int
+IO_write_all_off(ios_device_t *h)
+{
+    assert(h);
+
+    if (!h->device_open) {
+        h->output_pending = 1;
+        return -1;
+    }
+
+    return IO_write_result(h, h->driver->write(h, &h->off_frame, 0), 0);
+}
+
+/* returns 0 and the input bits, -1 when the board can not report them */
+int
+IO_read_inputs(ios_device_t *h, uint32_t *inputs)
+{
+    if (!h->device_open || NULL == h->driver->read_inputs)
+        return -1;
+    return h->driver->read_inputs(h, inputs);
+}
+
+/* returns 0 and the relays the board reports on, -1 when it can not tell */
+int
+IO_read_state(ios_device_t *h, uint32_t *relays)
+{
+    if (!h->device_open || NULL == h->driver->read_state)
+        return -1;
+    return h->driver->read_state(h, relays);
+}
+
+void
+IO_close_device(ios_device_t *h)
+{
+    assert(h);
+
+    if (h->device_open)
+        h->driver->close(h);
+    h->device_open = 0;
+}
@@ -0,0 +1,111 @@
+/*
+ * File:   driver.h
+ * Board driver layer : the device state and the interface every board implements
+ *
+ * A driver finds and opens its board (probe), initializes it (setup),
+ * encodes a relay mask into a frame and writes a frame with as few
+ * transfers as the board allows. A relay change is one driver write,
+ * on the wire that is, all synchronous :
+ *   ch341a : 27 bulk transfers, one per step of the shift register clocking
+ *   elomax : 1 control transfer
+ *   hidraw : 1 feature report per relay that changes, 1 for all on or all off
+ * Encoding is cheap next to that, frames are encoded when written,
+ * only the all-off frame is built ahead (setup).
+ *
+ * Every driver can run against a fake device node (-n), then the raw
+ * transfers/reports are written to that file instead of the board.
+ */
+
+#ifndef DRIVER_H
+#define	DRIVER_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <signal.h>
+#include <stdint.h>
+
+#define IOS_MAX_OUTPUTS   8
+#define IOS_FRAME_MAX     28 /* largest frame, ch341a needs 27 */
+
+typedef enum device_brand
+{
+    ABACOM = 0, ELOMAX = 1, HIDRAW = 2, DEVICE_BRAND_LAST
+} device_brand_t;
+
+/* encoded relay mask, ready to be written */
+typedef struct ios_frame
+{
+    uint32_t mask; // outputs after this frame
+    int len; // bytes used in data
+    uint8_t data[IOS_FRAME_MAX];
+} ios_frame_t;
+
+struct ios_driver;
+struct libusb_context;
+struct libusb_device_handle;
+
+/* the board, everything a driver may read or change */
+typedef struct ios_device
+{
+    const struct ios_driver *driver; // board driver, chosen by device_brand
+    device_brand_t device_brand; /* 0 = ch341a 1= Elomax IOsolutions I2c device 2 = hidraw relay board */
+    int device_open; // probe succeeded, cleared when the board is lost
+    int outputs; // relays on this board
+    uint32_t output_mask; // (1 << outputs) - 1
+    uint32_t outputbits; // bit mask set
+
+    /* flag when output needs to be sent, but is not yet done (retry later ?) */
+    int output_pending; // cleared by write success
+
+    struct libusb_context *usb_context; // pointer to usb context
+    struct libusb_device_handle *device_handle; // pointer to the usb device handle
+    int fd; // hidraw or fake device node, -1 = none
+    int fake_node; // fd is a plain file/fifo standing in for the board
+    const char *node; // -n : device node to use instead of searching the bus
+
+    ios_frame_t off_frame; // precomputed all-off frame
+    volatile sig_atomic_t *preempt; // when set, frames in progress are abandoned
+} ios_device_t;
+
+/* write results */
+#define IOS_WRITE_OK        0
+#define IOS_WRITE_ERROR     1
+#define IOS_WRITE_PREEMPTED 2 /* abandoned for an all-off request */
+
+typedef struct ios_driver
+{
+    const char *name;
+    uint16_t vid;
+    uint16_t pid;
+    int outputs; // relays, setup() may correct it for the board found
+    int atomic_mask; // 1 = all outputs switch at once, 0 = relay by relay
+
+    int (*probe)(ios_device_t *h); // find the board and open it, 0 = found
+    int (*setup)(ios_device_t *h); // one time init after probe, 0 = ok, NULL = none
+    void (*encode)(const ios_device_t *h, uint32_t mask, ios_frame_t *frame);
+    int (*write)(ios_device_t *h, const ios_frame_t *frame, int preemptible);
+    int (*read_inputs)(ios_device_t *h, uint32_t *inputs); // NULL = board has no inputs
+    int (*read_state)(ios_device_t *h, uint32_t *relays); // relays as the board reports them, NULL = can not
+    void (*close)(ios_device_t *h);
+} ios_driver_t;
+
+extern const ios_driver_t ch341a_driver;
+extern const ios_driver_t elomax_driver;
+extern const ios_driver_t hidraw_driver;
+
+/* generic layer, driver.c */
+int IO_open_device(ios_device_t *dev);
+int IO_setup_device(ios_device_t *dev);
+int IO_write(ios_device_t *dev, uint32_t mask);
+int IO_write_all_off(ios_device_t *dev);
+int IO_read_inputs(ios_device_t *dev, uint32_t *inputs);
+int IO_read_state(ios_device_t *dev, uint32_t *relays);
+void IO_close_device(ios_device_t *dev);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* DRIVER_H */
@@ -0,0 +1,193 @@
+/*
+ * hidraw board driver : 16c0:05df "USBRelayN" HID relay boards
+ * see driver.h
+ *
+ * The board takes one 9 byte feature report per change,
+ *   [0] report id (0)
+ *   [1] 0xFF relay on, 0xFD relay off, 0xFE all on, 0xFC all off
+ *   [2] relay number 1..8
+ * and reports its relay state in byte 8 of the feature report it returns.
+ * No libusb, no kernel driver detach, the kernel hid driver stays bound.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <linux/hidraw.h>
+#include "logging.h"
+#include "driver.h"
+
+#define HIDRAW_REPORT_LEN 9
+#define HIDRAW_MAX_NODES  64 /* /dev/hidraw0 .. /dev/hidraw63 */
+
+#define HIDRAW_CMD_ON      0xFF
+#define HIDRAW_CMD_OFF     0xFD
+#define HIDRAW_CMD_ALL_ON  0xFE
+#define HIDRAW_CMD_ALL_OFF 0xFC
+
+/* prebuilt reports, filled by hidraw_setup() */
+static uint8_t report_relay[IOS_MAX_OUTPUTS][2][HIDRAW_REPORT_LEN]; /* [relay][off, on] */
+static uint8_t report_all[2][HIDRAW_REPORT_LEN]; /* [all off, all on] */
+
+static int
+hidraw_open(ios_device_t *h, const char *node)
+{
+    struct stat sb;
+
+    h->fd = open(node, O_RDWR | O_CLOEXEC);
+    if (h->fd < 0)
+        return -1;
+
+    /* anything but a character device is a fake board for testing */
+    h->fake_node = (fstat(h->fd, &sb) == 0 && !S_ISCHR(sb.st_mode));
+    return 0;
+}
+
+static int
+hidraw_probe(ios_device_t *h)
+{
+    char node[32];
+    struct hidraw_devinfo info;
+
+    if (h->node) {
+        if (hidraw_open(h, h->node) < 0) {
+            lwsl_warn("Cannot open %s : %s\n", h->node, strerror(errno));
+            return -1;
+        }
+        return 0;
+    }
+
+    for (int n = 0; n < HIDRAW_MAX_NODES; n++) {
+        snprintf(node, sizeof (node), "/dev/hidraw%d", n);
+        if (hidraw_open(h, node) < 0)
+            continue;
+        if (ioctl(h->fd, HIDIOCGRAWINFO, &info) == 0
+            && (uint16_t) info.vendor == h->driver->vid
+            && (uint16_t) info.product == h->driver->pid) {
+            lwsl_info("Device is open : %s\n", node);
+            return 0;
+        }
+        close(h->fd);
+        h->fd = -1;
+    }
+
+    lwsl_warn("Cannot open device: no hidraw node %04x:%04x\n",
+              h->driver->vid, h->driver->pid);
+    return -1;
+}
+
+static int
+hidraw_send(ios_device_t *h, const uint8_t *report)
+{
+    if (h->fake_node)
+        return (write(h->fd, report, HIDRAW_REPORT_LEN) != HIDRAW_REPORT_LEN);
+    return (ioctl(h->fd, HIDIOCSFEATURE(HIDRAW_REPORT_LEN), report) < 0);
+}
+
+static int
+hidraw_read_state(ios_device_t *h, uint32_t *relays)
+{
+    /* no inputs on these boards, the state report gives the relays back */
+    uint8_t report[HIDRAW_REPORT_LEN] = {0};
+
+    if (h->fake_node || ioctl(h->fd, HIDIOCGFEATURE(HIDRAW_REPORT_LEN), report) < 0)
+        return -1;
+    *relays = report[8] & h->output_mask;
+    return 0;
+}
+
+static int
+hidraw_setup(ios_device_t *h)
+{
+    char name[64] = {0};
+
+    /* "www.dcttech.com USBRelay2" : the digit is the number of relays */
+    if (!h->fake_node && ioctl(h->fd, HIDIOCGRAWNAME(sizeof (name) - 1), name) >= 0) {
+        const char *p = strstr(name, "USBRelay");
+        int outputs = p ? atoi(p + 8) : 0;
+        if (outputs > 0 && outputs <= IOS_MAX_OUTPUTS)
+            h->outputs = outputs;
+        lwsl_info("hidraw : %s\n", name);
+    }
+
+    memset(report_relay, 0, sizeof (report_relay));
+    memset(report_all, 0, sizeof (report_all));
+    for (int i = 0; i < IOS_MAX_OUTPUTS; i++) {
+        report_relay[i][0][1] = HIDRAW_CMD_OFF;
+        report_relay[i][0][2] = i + 1;
+        report_relay[i][1][1] = HIDRAW_CMD_ON;
+        report_relay[i][1][2] = i + 1;
+    }
+    report_all[0][1] = HIDRAW_CMD_ALL_OFF;
+    report_all[1][1] = HIDRAW_CMD_ALL_ON;
+
+    /* know what is on now, then a change is a single report */
+    uint32_t state;
+    h->output_mask = (1u << h->outputs) - 1;
+    if (hidraw_read_state(h, &state) == 0) {
+        h->outputbits = state;
+        h->output_pending = 0;
+    }
+    return 0;
+}
+
+static void
+hidraw_encode(const ios_device_t *h, uint32_t mask, ios_frame_t *frame)
+{
+    /* the reports are prebuilt, the frame only carries the target */
+    (void) h;
+    memset(frame, 0, sizeof (*frame));
+    frame->mask = mask;
+}
+
+static int
+hidraw_write(ios_device_t *h, const ios_frame_t *frame, int preemptible)
+{
+    uint32_t mask = frame->mask;
+
+    if (0 == mask)
+        return hidraw_send(h, report_all[0]) ? IOS_WRITE_ERROR : IOS_WRITE_OK;
+    if (h->output_mask == mask)
+        return hidraw_send(h, report_all[1]) ? IOS_WRITE_ERROR : IOS_WRITE_OK;
+
+    /* only the relays that change, all of them when the state is unknown */
+    uint32_t change = h->output_pending ? h->output_mask : (mask ^ h->outputbits);
+    for (int i = 0; i < h->outputs; i++) {
+        if (!(change & (1u << i)))
+            continue;
+        if (preemptible && h->preempt && *h->preempt)
+            return IOS_WRITE_PREEMPTED;
+        if (hidraw_send(h, report_relay[i][(mask >> i) & 1]))
+            return IOS_WRITE_ERROR;
+    }
+    return IOS_WRITE_OK;
+}
+
+static void
+hidraw_close(ios_device_t *h)
+{
+    if (h->fd >= 0)
+        close(h->fd);
+    h->fd = -1;
+    h->fake_node = 0;
+}
+
+const ios_driver_t hidraw_driver = {
+    .name = "hidraw",
+    .vid = 0x16c0,
+    .pid = 0x05df,
+    .outputs = 8,
+    .atomic_mask = 0,
+    .probe = hidraw_probe,
+    .setup = hidraw_setup,
+    .encode = hidraw_encode,
+    .write = hidraw_write,
+    .read_inputs = NULL,
+    .read_state = hidraw_read_state,
+    .close = hidraw_close,
+};
@@ -0,0 +1,304 @@
+/*
+ * libusb board drivers : Abacom CH341A relay board and Elomax I2CSolution
+ * see driver.h
+ *
+ * inspired by : usb-relay - a tiny control program for a CH341A based relay board.
+ * Copyright (C) 2010  Henning Rohlfs GPL2 license
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <libusb.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "logging.h"
+#include "driver.h"
+
+#define CH341A_FRAME_LEN 27 /* start, 8 x 3 clock steps, end */
+#define ELOMAX_PACKET_LEN 8
+
+/* With a fake device node (-n) every USB transfer is written to it unchanged */
+static int
+fake_open(ios_device_t *h)
+{
+    h->fd = open(h->node, O_WRONLY | O_CLOEXEC);
+    if (h->fd < 0) {
+        lwsl_warn("Cannot open fake device node %s : %s\n", h->node, strerror(errno));
+        return -1;
+    }
+    h->fake_node = 1;
+    return 0;
+}
+
+static int
+usb_probe(ios_device_t *handle)
+{
+    assert(NULL == handle->device_handle);
+
+    if (handle->node)
+        return fake_open(handle);
+
+    libusb_device **devs = {0}; // to retrieve a list of devices
+    libusb_device_handle *udh = NULL;
+    libusb_context *ctx = NULL;
+
+    int r = libusb_init(&ctx); // initialize the library for the session we just declared
+
+    if (r < 0) {
+        lwsl_err("Init Error %d\n", r); // there was an error
+        return -1;
+    }
+
+    libusb_set_debug(ctx, 3);
+
+    ssize_t cnt = libusb_get_device_list(ctx, &devs); // get the list of devices
+    if (cnt < 0) {
+        lwsl_err("Get Device Error\n"); // there was an error
+        libusb_exit(ctx);
+        return -1;
+    }
+
+    lwsl_info("[%ld] Devices in list.\n", cnt);
+    libusb_free_device_list(devs, 1); // free the list, unref the devices in it
+
+    udh = libusb_open_device_with_vid_pid(ctx, handle->driver->vid, handle->driver->pid);
+    if (!udh) {
+        lwsl_warn("Cannot open device: libusb %p\n", udh);
+        libusb_exit(ctx);
+        return -1;
+    }
+    lwsl_info("Device is open\n");
+
+    if (libusb_kernel_driver_active(udh, 0) == 1) { // find out if kernel driver is attached
+        lwsl_info("Kernel Driver Active\n");
+
+        if (libusb_detach_kernel_driver(udh, 0) == 0) // detach it
+            lwsl_info("Kernel Driver Detached!\n");
+        else
+            lwsl_info("Kernel Driver Detach failed!\n");
+
+    }
+
+    r = libusb_claim_interface(udh, 0); // claim interface 0
+
+    if (r < 0) {
+        lwsl_info("Cannot Claim Interface : %d\n", r);
+        libusb_close(udh);
+        libusb_exit(ctx);
+        return -1;
+    }
+
+    lwsl_info("Claimed Interface\n");
+
+    handle->usb_context = ctx;
+    handle->device_handle = udh; // copy for later use
+    return 0; // success
+}
+
+static void
+usb_close(ios_device_t *h)
+{
+    if (h->fd >= 0) {
+        close(h->fd);
+        h->fd = -1;
+        h->fake_node = 0;
+        return;
+    }
+
+    if (h->device_handle)
+        libusb_close(h->device_handle);
+    h->device_handle = NULL;
+
+    if (h->usb_context)
+        libusb_exit(h->usb_context);
+    h->usb_context = NULL;
+}
+
+/* ---- Elomax I2CSolution ---- */
+
+/* For API documentation see iosolution.h */
+/* I2CSolution van Elomax is USB device */
+
+static int
+ios_send(ios_device_t *handle, const uint8_t *packet)
+{
+    /* bmRequest Type
+     * Bit 7: Request direction (0=Host to device – Out, 1=Device to host – In).
+     * Bits 5-6: Request type (0=standard, 1=class, 2=vendor, 3=reserved).
+     * Bits 0-4: Recipient (0=device, 1=interface, 2=endpoint, 3=other).
+     *
+     * int usb_control_msg(
+     * usb_dev_handle *dev,
+     * int requesttype, 0x21 see doc
+     * int request, 0x09 (set configuration)
+     * int value, (??)
+     * int index, (??)
+     * char *bytes, (data)
+     * int size, (number of bytes in data)
+     * int timeout); (milli seconds)
+     * */
+    //libusb_set_configuration()
+    /* 0x21 Byte : 0010 0001 , class, interface, host to device */
+    static const int packet_len = ELOMAX_PACKET_LEN;
+    uint8_t data[ELOMAX_PACKET_LEN];
+
+    memcpy(data, packet, packet_len);
+
+    if (handle->fd >= 0)
+        return write(handle->fd, data, packet_len);
+
+    if (NULL == handle->device_handle) {
+        fprintf(stderr, "could not send, handle==null\n");
+        return (-1);
+    }
+    int writen_size = libusb_control_transfer(
+                                              handle->device_handle, 0x21,
+                                              LIBUSB_REQUEST_SET_CONFIGURATION,
+                                              0x00, 0,
+                                              data, packet_len,
+                                              100);
+
+    if (writen_size != packet_len) {
+        fprintf(stderr, "Failed to send all the byte of the packet (%i)\n", writen_size);
+
+    }
+
+    return writen_size;
+}
+
+static int
+elomax_setup(ios_device_t *handle)
+{
+    /* the elomax device needs some setup before accepting commands */
+    static const uint8_t pull_ups[ELOMAX_PACKET_LEN] = {0x55, 0xFF, 0xFF};
+
+    lwsl_debug("ELOMAX, setup enable pull ups\n");
+    return (ios_send(handle, pull_ups) < 0) ? -1 : 0;
+}
+
+static void
+elomax_encode(const ios_device_t *h, uint32_t mask, ios_frame_t *frame)
+{
+    (void) h;
+    memset(frame, 0, sizeof (*frame));
+    frame->mask = mask;
+    frame->len = ELOMAX_PACKET_LEN;
+    frame->data[0] = 0x4F; /* command for i2csolution */
+    frame->data[1] = (uint8_t) mask; /* bitjes van poort 0 */
+    frame->data[2] = 0xFF; /* bitjes van poort 1 (inputs) allemaal hoog wegens pullups */
+}
+
+static int
+elomax_write(ios_device_t *h, const ios_frame_t *frame, int preemptible)
+{
+    /* one packet, nothing to preempt */
+    (void) preemptible;
+    return (ios_send(h, frame->data) < 0) ? IOS_WRITE_ERROR : IOS_WRITE_OK;
+}
+
+const ios_driver_t elomax_driver = {
+    .name = "elomax",
+    .vid = 0x07a0,
+    .pid = 0x1008,
+    .outputs = 8,
+    .atomic_mask = 1,
+    .probe = usb_probe,
+    .setup = elomax_setup,
+    .encode = elomax_encode,
+    .write = elomax_write,
+    .read_inputs = NULL,
+    .read_state = NULL,
+    .close = usb_close,
+};
+
+/* ---- Abacom CH341A in MEM mode, A6275EA shift register ---- */
+
+static int
+send_relay_cmd(ios_device_t *h, uint8_t cmd)
+{
+    static const unsigned char ch341a_cmd_part1[] = {0xa1, 0x6a, 0x1f, 0x00, 0x10};
+    static const unsigned char ch341a_cmd_part2[] = {0x3f, 0x00, 0x00, 0x00, 0x00};
+
+    uint8_t buf[32] = {0}; // buf is large enough
+    int n = sizeof (ch341a_cmd_part1);
+    int m = sizeof (ch341a_cmd_part2);
+
+    /* fill buf with complete message */
+    memcpy(buf, ch341a_cmd_part1, n);
+    buf[n] = cmd;
+    memcpy(buf + n + 1, ch341a_cmd_part2, m);
+
+    /* send message to usb endpoint */
+    static const int endpointid = 2; // for some reason
+    int numbytes = n + m + 1;
+    int actual_length = 0;
+
+    if (h->fd >= 0)
+        return (write(h->fd, buf, numbytes) != numbytes);
+
+    /* do usb action, rv !=0 on error */
+    int rv = libusb_bulk_transfer(h->device_handle, endpointid, buf, numbytes, &actual_length, 100);
+
+
+    //for (int i = 0; i < numbytes; i++)
+    //    lwsl_debug("pos=%02d val=%02x", i, buf[i]);
+
+    if (rv != 0)
+        lwsl_notice("libusb_bulk_transfer() failed\n");
+
+    // return 0 on successful write
+    return (numbytes != actual_length);
+}
+
+static void
+ch341a_encode(const ios_device_t *h, uint32_t mask, ios_frame_t *frame)
+{
+    int n = 0;
+
+    (void) h;
+    frame->mask = mask;
+    /* Start the command frame */
+    frame->data[n++] = 0x00;
+    /* clock in every bit of the mask, msb first : data, data|clock, data */
+    for (uint8_t bitmask = 128; bitmask > 0; bitmask >>= 1) {
+        uint8_t bit = (mask & bitmask) ? 0x20 : 0x00;
+        frame->data[n++] = bit;
+        frame->data[n++] = bit | 0x08;
+        frame->data[n++] = bit;
+    }
+    /* End the command frame, latch the outputs */
+    frame->data[n++] = 0x00;
+    frame->data[n++] = 0x01;
+    assert(CH341A_FRAME_LEN == n);
+    frame->len = n;
+}
+
+static int
+ch341a_write(ios_device_t *h, const ios_frame_t *frame, int preemptible)
+{
+    /* a frame abandoned half way is harmless, nothing latches before the last step */
+    for (int i = 0; i < frame->len; i++) {
+        if (preemptible && h->preempt && *h->preempt)
+            return IOS_WRITE_PREEMPTED;
+        if (send_relay_cmd(h, frame->data[i]))
+            return IOS_WRITE_ERROR;
+    }
+    return IOS_WRITE_OK;
+}
+
+const ios_driver_t ch341a_driver = {
+    .name = "ch341a",
+    .vid = 0x1a86,
+    .pid = 0x5512,
+    .outputs = 8,
+    .atomic_mask = 1,
+    .probe = usb_probe,
+    .setup = NULL,
+    .encode = ch341a_encode,
+    .write = ch341a_write,
+    .read_inputs = NULL,
+    .read_state = NULL,
+    .close = usb_close,
+};
@@ -6,6 +6,25 @@
 
 #include "logging.h"
 
+int log_level = LLL_ERR | LLL_WARN | LLL_NOTICE;
+void (*lwsl_emit)(int level, const char *line) = lwsl_emit_stderr;
+
+static const char * const log_level_names[] = {
+    "ERR",
+    "WARN",
+    "NOTICE",
+    "INFO",
+    "DEBUG",
+};
+
+/* deferred lines, filled by _lws_log() while defer_log is set */
+static int defer_log;
+static unsigned defer_head, defer_tail, defer_dropped;
+static struct {
+    int level;
+    char line[256];
+} defer_ring[LWS_LOG_DEFER_LINES];
+
 void
 lwsl_emit_stderr(int level, const char *line)
 {
@@ -57,6 +76,21 @@ _lws_log(int filter, const char *format, ...)
     if (!(log_level & filter))
         return;
 
+    if (defer_log) {
+        /* no blocking I/O here, format into the ring and emit later */
+        if (defer_head - defer_tail >= LWS_LOG_DEFER_LINES) {
+            defer_dropped++;
+            return;
+        }
+        unsigned slot = defer_head % LWS_LOG_DEFER_LINES;
+        va_start(ap, format);
+        vsnprintf(defer_ring[slot].line, sizeof (defer_ring[slot].line), format, ap);
+        va_end(ap);
+        defer_ring[slot].level = filter;
+        defer_head++;
+        return;
+    }
+
     va_start(ap, format);
     vsnprintf(buf, sizeof (buf), format, ap);
     buf[sizeof (buf) - 1] = '\0';
@@ -84,3 +118,39 @@ lws_set_log_level(int level, void (*log_emit_function)(int level,
     if (log_emit_function)
         lwsl_emit = log_emit_function;
 }
+
+/**
+ * lws_log_defer() - Queue log lines instead of emitting them
+ * @defer:	non zero to queue, zero to emit directly again
+ *
+ *	Used by the real-time mode, the event loop calls lws_log_flush()
+ *	once the relay frame has been written.
+ */
+
+void
+lws_log_defer(int defer)
+{
+    if (!defer)
+        lws_log_flush();
+    defer_log = defer;
+}
+
+/**
+ * lws_log_flush() - Emit all queued log lines
+ */
+
+void
+lws_log_flush(void)
+{
+    while (defer_tail != defer_head) {
+        unsigned slot = defer_tail % LWS_LOG_DEFER_LINES;
+        lwsl_emit(defer_ring[slot].level, defer_ring[slot].line);
+        defer_tail++;
+    }
+    if (defer_dropped) {
+        char buf[64];
+        snprintf(buf, sizeof (buf), "%u deferred log lines dropped\n", defer_dropped);
+        defer_dropped = 0;
+        lwsl_emit(LLL_WARN, buf);
+    }
+}
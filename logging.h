@@ -41,21 +41,23 @@ extern void _lws_log(int filter, const char *format, ...);
 #define lwsl_debug(...) _lws_log(LLL_DEBUG, __VA_ARGS__)
 
 
-static int log_level = LLL_ERR | LLL_WARN | LLL_NOTICE;
+/* defined once in logging.c */
+extern int log_level;
 void lwsl_emit_stderr(int level, const char *line);
 void lwsl_emit_syslog(int level, const char *line);
-void (*lwsl_emit)(int level, const char *line); // = lwsl_emit_stderr;
+extern void (*lwsl_emit)(int level, const char *line);
 
 void lws_set_log_level(int level, void (*log_emit_function)(int level,
         const char *line));
 
-static const char * const log_level_names[] = {
-    "ERR",
-    "WARN",
-    "NOTICE",
-    "INFO",
-    "DEBUG",
-};
+/* real-time mode: queue formatted lines, emit them later from lws_log_flush() */
+#ifdef SMALL_FOOTPRINT
+#define LWS_LOG_DEFER_LINES 8
+#else
+#define LWS_LOG_DEFER_LINES 32
+#endif
+void lws_log_defer(int defer);
+void lws_log_flush(void);
 
 #ifdef	__cplusplus
 }
@@ -11,7 +11,6 @@
  */
 
 #include <assert.h>
-#include <libusb.h>
 #include <malloc.h>
 #include <stdint.h>
 #include <stdio.h>
@@ -24,9 +23,16 @@
 #include <sys/ioctl.h>
 #include <sys/inotify.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
 #include <sys/stat.h>
 #include "main.h"
 #include "logging.h"
+#include "rt.h"
+#include "control.h"
+#include "mem.h"
+#include "driver.h"
 
 /* Control IO via existence of files in Temp directory 
  * External programs can easily monitor this using inotify scripts
@@ -38,363 +44,568 @@
  */
 
 #define EVENT_SIZE  ( sizeof (struct inotify_event) )
+#ifdef SMALL_FOOTPRINT
+#define EVENT_BUF_LEN     ( 64 * ( EVENT_SIZE + 16 ) )
+#else
 #define EVENT_BUF_LEN     ( 1024 * ( EVENT_SIZE + 16 ) )
+#endif
 
-static const int FIRST_RELAY_NO = 1;
-static const int LAST_RELAY_NO = 8;
-
-typedef enum device_brand
-{
-    ABACOM = 0, ELOMAX = 1, DEVICE_BRAND_LAST
-} device_brand_t;
+/* board lost in daemon mode : try to open it again this often */
+#define DEVICE_RETRY_MS 1000
 
-/* For API documentation see iosolution.h */
-/* I2CSolution van Elomax is USB device */
+/* reserved file name, its existence latches all relays off */
+#define ALL_OFF_FILE "D_ALL_OFF"
 
-static const uint16_t vid_table[] = {0x1a86, 0x07a0};
-static const uint16_t pid_table[] = {0x5512, 0x1008};
+static const int FIRST_RELAY_NO = 1;
+static const int LAST_RELAY_NO = IOS_MAX_OUTPUTS;
 
-typedef struct
+/* all state and buffers of the program, fixed size,
+ * nothing is allocated after startup */
+static struct
 {
-    uint32_t active_relays; // bit mask requested 
-    uint32_t outputbits; // bit mask set
-    uint8_t data[8]; // buf for Elomax
-
-    libusb_context *usb_context; // pointer to usb context
-    libusb_device_handle *device_handle; // pointer to the usb device handle
-    device_brand_t device_brand; /* 0 = ch341a 1= Elomax IOsolutions I2c device */
-
-    /* flag when output needs to be sent, but is not yet done (retry later ?) */
-    int output_pending; // cleared by write success 
-    // int verbose; // verbose output to console
-    int use_syslog; // use syslog for logging instead of console
-    int run_as_daemon; // run as daemon, use /tmp/ID/D_OUT_99 inotify for control
-    char *event_dir; // where to listen and send events
-} ios_handle_t;
+    ios_handle_t handle;
+    char event_buf[EVENT_BUF_LEN]; // inotify read buffer
+    char path[PATH_BUF_LEN]; // file name buffer
+    char batch_line[256]; // one line of batch input
+    int8_t wd_tenant[IOS_WD_TABLE]; // inotify watch descriptor -> tenant index + 1, 0 = unknown
+    uint64_t client_since[CONTROL_MAX_CLIENTS]; // control client accepted at, for CONTROL_TIMEOUT_MS
+} arena;
+
+/* set by SIGUSR2, checked between USB transfers */
+static volatile sig_atomic_t all_off_request;
+static volatile uint64_t all_off_request_ns;
+static int all_off_pipe[2] = {-1, -1}; /* wakes up poll() from the signal handler */
 
 /* declaration */
-void USB_close_device(ios_handle_t *h);
-int USB_open_device(ios_handle_t *handle, uint16_t VID, uint16_t PID);
-int USB_setup_device(ios_handle_t *handle);
-int USB_write_IO(ios_handle_t *handle);
 int run_as_daemon(ios_handle_t *h);
 int run_once(ios_handle_t *h, int argc, char *argv[]);
+int run_batch(ios_handle_t *h, const char *path);
 
 /* implementation */
-static int
-ios_send(ios_handle_t *handle)
+int
+run_once(ios_handle_t *h, int argc, char *argv[])
 {
-    /* bmRequest Type	 
-     * Bit 7: Request direction (0=Host to device – Out, 1=Device to host – In).
-     * Bits 5-6: Request type (0=standard, 1=class, 2=vendor, 3=reserved).
-     * Bits 0-4: Recipient (0=device, 1=interface, 2=endpoint, 3=other).
-     *
-     * int usb_control_msg(
-     * usb_dev_handle *dev,
-     * int requesttype, 0x21 see doc
-     * int request, 0x09 (set configuration)
-     * int value, (??)
-     * int index, (??)
-     * char *bytes, (data)
-     * int size, (number of bytes in data)
-     * int timeout); (milli seconds)
-     * */
-    //libusb_set_configuration()
-    /* 0x21 Byte : 0010 0001 , class, interface, host to device */
-    if (NULL == handle->device_handle) {
-        fprintf(stderr, "could not send, handle==null\n");
-        return (-1);
+    /* just set some outputs on or off and quit */
+    for (int i = optind; i < argc; i++) {
+        int relay = atoi(argv[i]);
+        if (relay < FIRST_RELAY_NO || relay > LAST_RELAY_NO) {
+            fprintf(stderr, "error: only give valid relay numbers (1-8) as parameter\n");
+            fprintf(stderr, "you can use -v as first option to enable verbose output debugging\n");
+            fprintf(stderr, "example: ./%s -v 1 5 7 will switch 1 5 and 7 on the rest will be off\n", argv[0]);
+            return 2;
+        }
+        h->active_relays |= (1 << (relay - 1));
     }
-    static const int packet_len = 8;
-    int writen_size = libusb_control_transfer(
-                                              handle->device_handle, 0x21,
-                                              LIBUSB_REQUEST_SET_CONFIGURATION,
-                                              0x00, 0,
-                                              handle->data, packet_len,
-                                              100);
-
-    if (writen_size != packet_len) {
-        fprintf(stderr, "Failed to send all the byte of the packet (%i)\n", writen_size);
+    lwsl_debug("writing byte %d to usb\n", h->active_relays);
 
+    if (0 == IO_open_device(&h->dev) && 0 == IO_setup_device(&h->dev)) {
+        IO_write(&h->dev, h->active_relays);
+        IO_close_device(&h->dev);
+    } else {
+        lwsl_warn("Error : device not open\n");
+        return 3;
     }
-
-    return writen_size;
+    return 0;
 }
 
-int
-USB_setup_device(ios_handle_t *handle)
+/* relay numbers after "on" or "off", NULL on a bad number */
+static char *
+batch_parse_relays(char *p, uint32_t *relays)
 {
-    /* the elomax device needs some setup before accepting commands */
-    assert(handle);
-    assert(handle->device_brand < DEVICE_BRAND_LAST);
-
-    switch (handle->device_brand) {
-    case ABACOM:
-        lwsl_debug("ABACOM, nothing to do, USB_setup_device()\n");
-        break;
-    case ELOMAX:
-        /* Elomax setup */
-        lwsl_debug("ELOMAX, USB_setup_device() enable pull ups\n");
-        /* setup the pull up resistors */
-        handle->data[0] = 0x55;
-        handle->data[1] = 0xFF;
-        handle->data[2] = 0xFF;
-        int r;
-        r = ios_send(handle);
-        if (r < 0) {
-            if (handle->device_handle != NULL) {
-                libusb_close(handle->device_handle);
-            }
-            handle->device_handle = NULL;
-            handle->output_pending = 1;
-            return -1;
-        } else {
-            /* success */
-            /* check for pending output and do it */
-            if (handle->output_pending) {
-                if (USB_write_IO(handle) != -1) {
-                    return 0;
-                } else {
-                    return -1;
-                }
-            }
-        }
-        break;
-    default:
-        fprintf(stderr, "can not happen. invalid device brand\n");
+    char *end;
+
+    *relays = 0;
+    while (*(p += strspn(p, " \t"))) {
+        long relay = strtol(p, &end, 10);
+        if (end == p || relay < FIRST_RELAY_NO || relay > LAST_RELAY_NO)
+            return NULL;
+        *relays |= 1u << (relay - 1);
+        p = end;
     }
-
-
-    return 0;
+    return p;
 }
 
+/*
+ * one line of batch input, one of :
+ *   <mask> [delay_ms]   set the outputs to mask, decimal or 0x hex, then wait
+ *   on <relay>...       switch these relays on, leave the others
+ *   off <relay>...      switch these relays off, leave the others
+ *   sleep <ms>          wait
+ * '#' starts a comment.
+ * returns 0 when *mask must be written, 1 when there is nothing to write, -1 on error
+ */
 static int
-send_relay_cmd(libusb_device_handle *dev, uint8_t cmd)
+batch_parse_line(char *line, uint32_t *mask, unsigned long *delay_ms)
 {
-    static const unsigned char ch341a_cmd_part1[] = {0xa1, 0x6a, 0x1f, 0x00, 0x10};
-    static const unsigned char ch341a_cmd_part2[] = {0x3f, 0x00, 0x00, 0x00, 0x00};
-
-    uint8_t buf[32] = {0}; // buf is large enough
-    int n = sizeof (ch341a_cmd_part1);
-    int m = sizeof (ch341a_cmd_part2);
-
-    /* fill buf with complete message */
-    memcpy(buf, ch341a_cmd_part1, n);
-    buf[n] = cmd;
-    memcpy(buf + n + 1, ch341a_cmd_part2, m);
+    char *p = line + strspn(line, " \t");
+    char *end;
+    uint32_t relays;
 
-    /* send message to usb endpoint */
-    static const int endpointid = 2; // for some reason
-    int numbytes = n + m + 1;
-    int actual_length = 0;
+    p[strcspn(p, "#\r\n")] = '\0';
+    *delay_ms = 0;
 
-    /* do usb action, rv !=0 on error */
-    int rv = libusb_bulk_transfer(dev, endpointid, buf, numbytes, &actual_length, 100);
+    if ('\0' == *p)
+        return 1;
 
+    if (0 == strncmp(p, "sleep", 5)) {
+        *delay_ms = strtoul(p + 5, &end, 10);
+        return (end == p + 5) ? -1 : 1;
+    }
+    if (0 == strncmp(p, "on", 2)) {
+        if (NULL == batch_parse_relays(p + 2, &relays))
+            return -1;
+        *mask |= relays;
+        return 0;
+    }
+    if (0 == strncmp(p, "off", 3)) {
+        if (NULL == batch_parse_relays(p + 3, &relays))
+            return -1;
+        *mask &= ~relays;
+        return 0;
+    }
 
-    //for (int i = 0; i < numbytes; i++)
-    //    lwsl_debug("pos=%02d val=%02x", i, buf[i]);
-
-    if (rv != 0)
-        lwsl_notice("libusb_bulk_transfer() failed");
-
-    // return 0 on successful write
-    return (numbytes != actual_length);
+    unsigned long m = strtoul(p, &end, 0);
+    if (end == p || m > 0xFF)
+        return -1;
+    p = end + strspn(end, " \t");
+    if (*p) {
+        *delay_ms = strtoul(p, &end, 10);
+        if (end == p || *(end + strspn(end, " \t")))
+            return -1;
+    }
+    *mask = (uint32_t) m;
+    return 0;
 }
 
-/* Actual communication with the device and saving the status */
 int
-USB_write_IO(ios_handle_t *handle)
+run_batch(ios_handle_t *h, const char *path)
 {
-    assert(handle);
-    libusb_device_handle *dev = handle->device_handle;
-    assert(dev);
-    uint8_t active_relays = (uint8_t) handle->active_relays;
-    //uint8_t verbose = handle->verbose;
-
-    if (ELOMAX == handle->device_brand) {
-        // do the Elomax protocol
-        handle->data[0] = 0x4F; /* command for i2csolution */
-        handle->data[1] = 0x00; /* port 0 output */
-        handle->data[2] = 0x00; /* port 1 output */
-        handle->data[3] = 0x00;
-        handle->data[4] = 0x00;
-        handle->data[5] = 0x00;
-        handle->data[6] = 0x00;
-        handle->data[7] = 0x00;
-
-        handle->data[1] = (unsigned char) active_relays; /* bitjes van poort 0 */
-        handle->data[2] = 0xFF; /* bitjes van poort 1 (inputs) allemaal hoog wegens pullups */
-
-        int r = ios_send(handle);
+    /* keep the device open and write one frame per step, back to back.
+     * Every write is synchronous, the rate is bounded by the round trips of one frame */
+    FILE *in = strcmp(path, "-") ? fopen(path, "r") : stdin;
+    if (NULL == in) {
+        fprintf(stderr, "error: cannot open batch input %s : %s\n", path, strerror(errno));
+        return 2;
+    }
+
+    if (0 != IO_open_device(&h->dev) || 0 != IO_setup_device(&h->dev)) {
+        lwsl_warn("Error : device not open\n");
+        if (in != stdin)
+            fclose(in);
+        return 3;
+    }
+
+    rt_latency_t step_latency;
+    rt_latency_reset(&step_latency);
+    unsigned long step = 0;
+    unsigned long lineno = 0;
+    uint32_t mask = 0;
+    int rc = 0;
+    uint64_t t_start = rt_now_ns();
+
+    while (fgets(arena.batch_line, sizeof (arena.batch_line), in)) {
+        unsigned long delay_ms = 0;
+        lineno++;
+
+        /* longer than the buffer : drop the rest of the line, fine when it is only a comment */
+        size_t len = strlen(arena.batch_line);
+        if (len && '\n' != arena.batch_line[len - 1]) {
+            int ch;
+            unsigned long dropped = 0;
+            while ((ch = getc(in)) != EOF && '\n' != ch)
+                dropped++;
+            if (dropped && NULL == strchr(arena.batch_line, '#')) {
+                lwsl_err("batch line %lu : longer than %d characters\n",
+                         lineno, (int) sizeof (arena.batch_line) - 2);
+                rc = 2;
+                break;
+            }
+        }
+
+        int r = batch_parse_line(arena.batch_line, &mask, &delay_ms);
         if (r < 0) {
-            if (handle->device_handle != NULL)
-                libusb_close(handle->device_handle);
-            handle->device_handle = NULL;
-            handle->output_pending = 1;
-        } else {
-            /* succes, so reset flag */
-            handle->outputbits = active_relays; /* keep state here */
-            handle->output_pending = 0;
+            lwsl_err("batch line %lu : can not parse '%s'\n", lineno, arena.batch_line);
+            rc = 2;
+            break;
         }
 
-    } else {
-        // do the ch341a protocol
-        /* Send the command frame */
-        if (send_relay_cmd(dev, 0x00)) goto error;
-        /* send stuff for every bit in the mask */
-        for (uint8_t mask = 128; mask > 0; mask >>= 1) {
-            if (active_relays & mask) {
-                /* Send "relay on" */
-                if (send_relay_cmd(dev, 0x20)) goto error;
-                if (send_relay_cmd(dev, 0x28)) goto error;
-                if (send_relay_cmd(dev, 0x20)) goto error;
-            } else {
-                /* Send "relay off" */
-                if (send_relay_cmd(dev, 0x00)) goto error;
-                if (send_relay_cmd(dev, 0x08)) goto error;
-                if (send_relay_cmd(dev, 0x00)) goto error;
+        if (0 == r) {
+            step++;
+            h->active_relays = mask;
+            uint64_t t_step = rt_now_ns();
+            if (IO_write(&h->dev, h->active_relays) != 0) {
+                lwsl_err("batch step %lu (line %lu) : hardware error, stopped\n", step, lineno);
+                rc = 4;
+                break;
             }
+            rt_latency_add(&step_latency, rt_now_ns() - t_step);
+        }
+
+        if (delay_ms) {
+            struct timespec ts = {delay_ms / 1000, (delay_ms % 1000) * 1000000};
+            while (nanosleep(&ts, &ts) < 0 && EINTR == errno)
+                ;
         }
-        /* End the command frame */
-        if (send_relay_cmd(dev, 0x00)) goto error;
-        if (send_relay_cmd(dev, 0x01)) goto error;
     }
 
-    /* Remember the status */
-    handle->output_pending = 0;
-    handle->outputbits = active_relays;
-    return 0; // success
-error:
-    if (handle->device_handle != NULL)
-        libusb_close(handle->device_handle);
-    handle->device_handle = NULL;
-    handle->output_pending = 1;
-    return -1; // problems
+    uint64_t elapsed = rt_now_ns() - t_start;
+    uint64_t busy = step_latency.sum_ns;
+
+    lwsl_notice("batch : %lu steps in %llums, %.1f updates/s overall, %.1f updates/s on the wire\n",
+                (unsigned long) step_latency.count,
+                (unsigned long long) (elapsed / 1000000),
+                elapsed ? step_latency.count * 1e9 / elapsed : 0.0,
+                busy ? step_latency.count * 1e9 / busy : 0.0);
+    rt_latency_report(&step_latency, "batch step");
+
+    IO_close_device(&h->dev);
+    if (in != stdin)
+        fclose(in);
+    return rc;
 }
 
-int
-USB_open_device(ios_handle_t *handle, uint16_t VID, uint16_t PID)
+static void
+all_off_signal(int sig)
 {
-    assert(NULL == handle->device_handle);
+    (void) sig;
+    int saved_errno = errno;
 
-    libusb_device **devs = {0}; // to retrieve a list of devices
-    libusb_device_handle *udh = NULL;
-    libusb_context *ctx = NULL;
+    if (!all_off_request) {
+        all_off_request_ns = rt_now_ns();
+        all_off_request = 1;
+    }
+    /* wake up poll(), a full pipe is fine, poll() is awake anyway */
+    if (write(all_off_pipe[1], "!", 1) < 0) {
+    }
+    errno = saved_errno;
+}
 
-    int r = libusb_init(&ctx); // initialize the library for the session we just declared
-    handle->usb_context = ctx;
+/* "signal,socket,file" for the ALL_OFF_BY_ bits */
+static const char *
+all_off_sources(int latched, char *buf, size_t len)
+{
+    snprintf(buf, len, "%s%s%s",
+             (latched & ALL_OFF_BY_SIGNAL) ? "signal," : "",
+             (latched & ALL_OFF_BY_SOCKET) ? "socket," : "",
+             (latched & ALL_OFF_BY_FILE) ? "file," : "");
+    if (buf[0])
+        buf[strlen(buf) - 1] = '\0';
+    return buf;
+}
 
-    if (r < 0) {
-        lwsl_err("Init Error %d\n", r); // there was an error
-        return -1;
+/* latch and send the precomputed all-off frame, nothing else goes first */
+static void
+all_off_trigger(ios_handle_t *h, int by, const char *source, uint64_t t_trigger)
+{
+    h->all_off_latched |= by;
+    int r = IO_write_all_off(&h->dev);
+    uint64_t t_off = rt_now_ns();
+
+    if (0 == r) {
+        rt_latency_add(&h->all_off_latency, t_off - t_trigger);
+        lwsl_warn("ALL OFF (%s) confirmed in %lluus, latched until cleared\n",
+                  source, (unsigned long long) ((t_off - t_trigger) / 1000));
+    } else {
+        lwsl_err("ALL OFF (%s) could not be written, device lost\n", source);
     }
+}
 
-    libusb_set_debug(ctx, 3);
-
-    ssize_t cnt = libusb_get_device_list(ctx, &devs); // get the list of devices
-    if (cnt < 0) {
-        lwsl_err("Get Device Error\n"); // there was an error
+/*
+ * release the ALL_OFF_BY_ sources in by, the file source only goes when
+ * no event directory holds D_ALL_OFF any more.
+ * returns 0 when cleared, -1 when another source still holds the latch
+ */
+static int
+all_off_clear(ios_handle_t *h, int by, const char *source)
+{
+    char held[32];
+
+    if (!h->all_off_latched)
+        return 0;
+
+    h->all_off_latched &= ~by;
+    if (h->all_off_files)
+        h->all_off_latched |= ALL_OFF_BY_FILE;
+    if (h->all_off_latched) {
+        lwsl_warn("ALL OFF clear (%s) refused, still latched by %s (%s in %d event directories)\n",
+                  source, all_off_sources(h->all_off_latched, held, sizeof (held)),
+                  ALL_OFF_FILE, h->all_off_files);
         return -1;
     }
 
+    lwsl_warn("ALL OFF cleared (%s), restoring relays 0x%02x\n", source, h->active_relays);
+    IO_write(&h->dev, h->active_relays);
+    return 0;
+}
 
-    lwsl_info("[%ld] Devices in list.\n", cnt);
-
-    udh = libusb_open_device_with_vid_pid(ctx, VID, PID); // ch341a_USB_VENDOR_ID, ch341a_USB_PROUCT_ID
-    if (!udh) {
-        lwsl_warn("Cannot open device: libusb %p\n", udh);
-        return -1;
-    } else {
-        lwsl_info("Device is open\n");
+static void
+all_off_check_signal(ios_handle_t *h)
+{
+    char dummy[16];
 
-        handle->device_handle = udh; // copy for later use
-    }
+    while (read(all_off_pipe[0], dummy, sizeof (dummy)) > 0)
+        ;
+    if (!all_off_request)
+        return;
 
-    libusb_free_device_list(devs, 1); // free the list, unref the devices in it
+    uint64_t t_trigger = all_off_request_ns;
+    all_off_request = 0;
+    all_off_trigger(h, ALL_OFF_BY_SIGNAL, "signal", t_trigger);
+}
 
-    if (libusb_kernel_driver_active(udh, 0) == 1) { // find out if kernel driver is attached
-        lwsl_info("Kernel Driver Active\n");
+/* "1-4", "5,7,8" or "1-3,8" */
+static int
+parse_relay_list(const char *s, uint32_t *relays)
+{
+    char *end;
 
-        if (libusb_detach_kernel_driver(udh, 0) == 0) // detach it
-            lwsl_info("Kernel Driver Detached!\n");
-        else
-            lwsl_info("Kernel Driver Detach failed!\n");
+    *relays = 0;
+    while (*s) {
+        long first = strtol(s, &end, 10);
+        long last = first;
+        if (end == s)
+            return -1;
+        if ('-' == *end) {
+            s = end + 1;
+            last = strtol(s, &end, 10);
+            if (end == s)
+                return -1;
+        }
+        if (first < FIRST_RELAY_NO || last > LAST_RELAY_NO || first > last)
+            return -1;
+        for (long relay = first; relay <= last; relay++)
+            *relays |= 1u << (relay - 1);
+        if (',' == *end)
+            end++;
+        else if (*end)
+            return -1;
+        s = end;
+    }
+    return *relays ? 0 : -1;
+}
 
+/* -i directory[:relays], a directory without relays owns all of them */
+static int
+add_tenant(ios_handle_t *h, const char *arg)
+{
+    if (h->ntenants >= IOS_MAX_TENANTS) {
+        fprintf(stderr, "too many event directories (max %d)\n", IOS_MAX_TENANTS);
+        return -1;
     }
 
-    r = libusb_claim_interface(udh, 0); // claim interface 0 
+    ios_tenant_t *t = &h->tenants[h->ntenants];
+    const char *colon = strrchr(arg, ':');
+    size_t len = strlen(arg);
+
+    /* a ':' followed by digits, ',' and '-' only is a relay list, it must be valid */
+    if (colon && colon[1] && strspn(colon + 1, "0123456789,-") == strlen(colon + 1)) {
+        if (parse_relay_list(colon + 1, &t->relays)) {
+            fprintf(stderr, "%s : invalid relay list, use %d..%d as in 1-4 or 1,3,5-8\n",
+                    colon + 1, FIRST_RELAY_NO, LAST_RELAY_NO);
+            return -1;
+        }
+        len = colon - arg;
+    } else
+        t->relays = (1u << LAST_RELAY_NO) - 1;
 
-    if (r < 0) {
-        lwsl_info("Cannot Claim Interface : %d\n", r);
-        handle->device_handle = NULL;
-        handle->output_pending = 1;
+    if (len >= sizeof (t->dir)) {
+        fprintf(stderr, "event directory name too long (max %d)\n", (int) sizeof (t->dir) - 1);
         return -1;
     }
+    memcpy(t->dir, arg, len);
+    t->dir[len] = '\0';
+
+    /* one inotify watch per directory : the same directory (or a path to it) twice
+     * would share one watch descriptor and starve the first owner */
+    struct stat sb;
+    if (stat(t->dir, &sb) < 0) {
+        fprintf(stderr, "%s : %s\n", t->dir, strerror(errno));
+        return -1;
+    }
+    t->dev = sb.st_dev;
+    t->ino = sb.st_ino;
 
-    lwsl_info("Claimed Interface\n");
-
-    handle->output_pending = 1;
+    for (int i = 0; i < h->ntenants; i++) {
+        if (h->tenants[i].dev == t->dev && h->tenants[i].ino == t->ino) {
+            fprintf(stderr, "%s : same directory as %s, give it once with all its relays\n",
+                    t->dir, h->tenants[i].dir);
+            return -1;
+        }
+        if (h->tenants[i].relays & t->relays) {
+            fprintf(stderr, "%s : relays 0x%02x already owned by %s\n", t->dir,
+                    h->tenants[i].relays & t->relays, h->tenants[i].dir);
+            return -1;
+        }
+    }
 
-    return 0; // success
+    h->ntenants++;
+    return 0;
 }
 
-void
-USB_close_device(ios_handle_t *h)
+/* D_OUT_<pin> created (on) or removed in a tenant directory, returns 1 when accepted */
+static int
+tenant_set_relay(ios_handle_t *h, ios_tenant_t *t, const char *name, int on)
 {
-    assert(h);
-    assert(h->usb_context);
+    int pin = 0;
+
+    if (1 != sscanf(name, "D_OUT_%d", &pin))
+        return 0;
 
-    if (h->device_handle)
-        libusb_close(h->device_handle);
+    uint32_t bit = (pin >= FIRST_RELAY_NO && pin <= LAST_RELAY_NO) ? 1u << (pin - 1) : 0;
+    if (!(t->relays & bit)) {
+        t->rejected++;
+        lwsl_warn("%s/%s : relay not owned by this directory, ignored\n", t->dir, name);
+        return 0;
+    }
 
-    libusb_exit(h->usb_context);
+    if (on)
+        h->active_relays |= bit;
+    else
+        h->active_relays &= ~bit;
+    t->events++;
+    lwsl_info("%s : set pin=%d %s\n", t->dir, pin, on ? "HIGH" : "LOW");
+    return 1;
 }
 
-int
-run_once(ios_handle_t *h, int argc, char *argv[])
+/* per event directory : accepted and rejected changes, rate and latency,
+ * to the control client or to the log when client_fd < 0 */
+static void
+tenant_report(ios_handle_t *h, int client_fd)
 {
-    /* just set some outputs on or off and quit */
-    for (int i = optind; i < argc; i++) {
-        int relay = atoi(argv[i]);
-        if (relay < FIRST_RELAY_NO || relay > LAST_RELAY_NO) {
-            fprintf(stderr, "error: only give valid relay numbers (1-8) as parameter\n");
-            fprintf(stderr, "you can use -v as first option to enable verbose output debugging\n");
-            fprintf(stderr, "example: ./%s -v 1 5 7 will switch 1 5 and 7 on the rest will be off\n", argv[0]);
-            return 2;
-        }
-        h->active_relays |= (1 << (relay - 1));
+    double secs = (rt_now_ns() - h->started_ns) / 1e9;
+
+    for (int i = 0; i < h->ntenants; i++) {
+        ios_tenant_t *t = &h->tenants[i];
+        const rt_latency_t *l = &t->latency;
+        char line[200];
+
+        snprintf(line, sizeof (line), "dir=%s relays=0x%02x events=%lu rejected=%lu"
+                 " rate=%.2f/s latency_avg=%lluus latency_max=%lluus\n",
+                 t->dir, t->relays, t->events, t->rejected,
+                 secs > 0 ? t->events / secs : 0.0,
+                 (unsigned long long) (l->count ? l->sum_ns / l->count / 1000 : 0),
+                 (unsigned long long) (l->max_ns / 1000));
+        if (client_fd >= 0)
+            control_send(client_fd, "%s", line);
+        else
+            lwsl_notice("%s", line);
     }
-    lwsl_debug("writing byte %d to usb\n", h->active_relays);
+}
 
-    if (0 == USB_open_device(h,
-                             vid_table[h->device_brand],
-                             pid_table[h->device_brand])) {
-        USB_setup_device(h);
-        USB_write_IO(h);
-        USB_close_device(h);
+/* new control client, it waits in the poll set until its command line is there */
+static void
+control_client_add(int listen_fd, struct pollfd *clients, uint64_t now)
+{
+    int c = control_accept(listen_fd);
+
+    if (c < 0)
+        return;
+    for (int i = 0; i < CONTROL_MAX_CLIENTS; i++)
+        if (clients[i].fd < 0) {
+            clients[i].fd = c;
+            arena.client_since[i] = now;
+            return;
+        }
+    control_reply(c, "ERR busy\n");
+}
+
+/* client readable (or gone) : read its command, never blocks */
+static void
+control_command(ios_handle_t *h, struct pollfd *client, uint64_t t_intake)
+{
+    char cmd[CONTROL_CMD_LEN];
+    int r = control_read(client->fd, cmd, sizeof (cmd));
+    int c = client->fd;
+
+    if (0 == r)
+        return;
+    client->fd = -1;
+    if (r < 0)
+        return;
+
+    lwsl_debug("control command '%s'\n", cmd);
+
+    if (0 == strcmp(cmd, "off")) {
+        all_off_trigger(h, ALL_OFF_BY_SOCKET, "socket", t_intake);
+        control_reply(c, "%s\n", h->dev.output_pending ? "ERR device lost" : "OK off");
+    } else if (0 == strcmp(cmd, "clear")) {
+        /* the operator's clear releases signal and socket, never the files */
+        if (all_off_clear(h, ALL_OFF_BY_SIGNAL | ALL_OFF_BY_SOCKET, "socket"))
+            control_reply(c, "ERR %s exists\n", ALL_OFF_FILE);
+        else
+            control_reply(c, "OK cleared\n");
+    } else if (0 == strcmp(cmd, "status")) {
+        uint32_t inputs = 0;
+        uint32_t relays = 0;
+        char inputs_text[16] = "none";
+        char state_text[16] = "unknown";
+        char latched[32];
+        if (0 == IO_read_inputs(&h->dev, &inputs))
+            snprintf(inputs_text, sizeof (inputs_text), "0x%02x", inputs);
+        if (0 == IO_read_state(&h->dev, &relays))
+            snprintf(state_text, sizeof (state_text), "0x%02x", relays);
+        control_reply(c, "board=%s latched=%s requested=0x%02x outputs=0x%02x pending=%d"
+                      " inputs=%s relay_state=%s all_off_count=%llu all_off_max=%lluus\n",
+                      h->dev.driver ? h->dev.driver->name : "none",
+                      h->all_off_latched ? all_off_sources(h->all_off_latched, latched, sizeof (latched)) : "0",
+                      h->active_relays, h->dev.outputbits,
+                      h->dev.output_pending, inputs_text, state_text,
+                      (unsigned long long) h->all_off_latency.count,
+                      (unsigned long long) (h->all_off_latency.max_ns / 1000));
+    } else if (0 == strcmp(cmd, "stats")) {
+        tenant_report(h, c);
+        control_reply(c, "OK\n");
     } else {
-        lwsl_warn("Error : device not open\n");
-        return 3;
+        control_reply(c, "ERR unknown command, use off|clear|status|stats\n");
     }
-    return 0;
+}
+
+/* board lost : open it again, then send what it has to show now, all off when latched */
+static int
+device_reconnect(ios_handle_t *h)
+{
+    if (0 != IO_open_device(&h->dev) || 0 != IO_setup_device(&h->dev))
+        return -1;
+
+    uint32_t relays = h->all_off_latched ? 0 : h->active_relays;
+    int r = h->all_off_latched ? IO_write_all_off(&h->dev) : IO_write(&h->dev, relays);
+    if (0 == r)
+        lwsl_notice("%s : board is back, relays set to 0x%02x\n", h->dev.driver->name, relays);
+    return r;
 }
 
 int
 run_as_daemon(ios_handle_t *h)
 {
     assert(h);
-    assert(h->device_brand < DEVICE_BRAND_LAST);
+    assert(h->dev.device_brand < DEVICE_BRAND_LAST);
+
+    lwsl_info("Keep Running, daemon not forking, %d event directories pid=%d\n",
+              h->ntenants, getpid());
+    h->started_ns = rt_now_ns();
+
+    /* the all-off frame is built by IO_setup_device(), before anything can ask for it */
+    h->dev.preempt = &all_off_request;
+    rt_latency_reset(&h->all_off_latency);
+
+    if (pipe(all_off_pipe) < 0)
+        perror("pipe");
+    fcntl(all_off_pipe[0], F_SETFL, O_NONBLOCK);
+    fcntl(all_off_pipe[1], F_SETFL, O_NONBLOCK);
 
-    lwsl_info("Keep Running, daemon not forking, eventpath=%s pid=%d\n",
-              h->event_dir, getpid());
+    struct sigaction sa;
+    memset(&sa, 0, sizeof (sa));
+    sa.sa_handler = all_off_signal;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGUSR2, &sa, NULL);
 
-    /* connect to USB IO board */
+    int ctl = -1;
+    if (h->control_path[0])
+        ctl = control_open(h->control_path);
+
+    /* connect to USB IO board, only a board that passed setup will do */
     while (1) {
-        if (0 == USB_open_device(h,
-                                 vid_table[h->device_brand],
-                                 pid_table[h->device_brand])) {
-            USB_setup_device(h);
+        if (0 == IO_open_device(&h->dev) && 0 == IO_setup_device(&h->dev)) {
             break;
         } else {
             lwsl_info("IO board not found, try again in 1 sec\n");
@@ -405,47 +616,172 @@ run_as_daemon(ios_handle_t *h)
     /* start the Inotify stuff */
     int fd = 0;
     int length = 0;
-    char buffer[EVENT_BUF_LEN] = {0};
-    int wd = 0;
+    char *buffer = arena.event_buf;
     int i = 0;
-    unsigned long int eventcounter = 0;
 
+    /* one inotify instance for all event directories,
+     * only creation and removal of files matter */
     fd = inotify_init();
 
     if (fd < 0)
         perror("inotify_init");
 
-    wd = inotify_add_watch(fd, h->event_dir, IN_ALL_EVENTS);
-
-    if (wd < 0)
-        perror("inotify_add_watch");
+    for (int t = 0; t < h->ntenants; t++) {
+        ios_tenant_t *tenant = &h->tenants[t];
+
+        rt_latency_reset(&tenant->latency);
+        tenant->wd = inotify_add_watch(fd, tenant->dir, IN_CREATE | IN_DELETE);
+        if (tenant->wd < 0)
+            lwsl_err("inotify_add_watch(%s) failed : %s\n", tenant->dir, strerror(errno));
+        else if (tenant->wd >= IOS_WD_TABLE)
+            lwsl_err("inotify_add_watch(%s) : watch %d out of range\n", tenant->dir, tenant->wd);
+        else if (arena.wd_tenant[tenant->wd]) {
+            /* replaced by the same directory as another one since the options were checked */
+            lwsl_err("%s : same watch as %s, refused\n", tenant->dir,
+                     h->tenants[arena.wd_tenant[tenant->wd] - 1].dir);
+            tenant->wd = -1;
+        } else
+            arena.wd_tenant[tenant->wd] = t + 1;
+        lwsl_info("watching %s for relays 0x%02x\n", tenant->dir, tenant->relays);
+    }
 
     /* set initial outputs based on stat() of files already present */
 
-    char b[4096] = {0}; /* file name buffer */
+    char *b = arena.path; /* file name buffer */
     struct stat sb; /* stat result buffer */
     unsigned relaybits = 0; /* bitpattern to set the relays to, clear */
 
-    /* loop over files, stat() files, set bits in pattern */
+    /* loop over files, stat() files, set bits in pattern, each directory for its own relays */
 
-    for (i = FIRST_RELAY_NO; i < (LAST_RELAY_NO + 1); i++) {
-        int len = snprintf(b, sizeof (b), "%s/D_OUT_%d", h->event_dir, i);
-        lwsl_debug("stat( %s ) len=%d\n", b, len);
-        if (stat(b, &sb) == 0) {
-            lwsl_debug("output (%d) ON\n", i);
-            relaybits |= (1 << (i - 1));
-        } else {
-            lwsl_debug("output (%d) OFF\n", i);
+    for (int t = 0; t < h->ntenants; t++) {
+        ios_tenant_t *tenant = &h->tenants[t];
+
+        for (i = FIRST_RELAY_NO; i < (LAST_RELAY_NO + 1); i++) {
+            if (!(tenant->relays & (1u << (i - 1))))
+                continue;
+            int len = snprintf(b, PATH_BUF_LEN, "%s/D_OUT_%d", tenant->dir, i);
+            lwsl_debug("stat( %s ) len=%d\n", b, len);
+            if (stat(b, &sb) == 0) {
+                lwsl_debug("output (%d) ON\n", i);
+                relaybits |= (1 << (i - 1));
+            } else {
+                lwsl_debug("output (%d) OFF\n", i);
 
+            }
+        }
+
+        snprintf(b, PATH_BUF_LEN, "%s/%s", tenant->dir, ALL_OFF_FILE);
+        if (stat(b, &sb) == 0) {
+            tenant->all_off_file = 1;
+            h->all_off_files++;
+            h->all_off_latched = ALL_OFF_BY_FILE;
         }
     }
 
     h->active_relays = relaybits;
-    USB_write_IO(h);
-    /* read to determine the event change happens on “/tmp” directory. 
-     * Actually this read blocks until the change event occurs*/
+    if (h->all_off_latched)
+        all_off_trigger(h, ALL_OFF_BY_FILE, "file at startup", rt_now_ns());
+    else
+        IO_write(&h->dev, h->active_relays);
+
+    /* latency from read() returning to the frame being written,
+     * and from the self-test touching a file to the frame being written */
+    rt_latency_t intake_latency;
+    rt_latency_t event_latency;
+    rt_latency_reset(&intake_latency);
+    rt_latency_reset(&event_latency);
+
+    rt_jitter_t *jitter = NULL;
+    pid_t jitter_pid = 0;
+    if (h->rt.jitter_runs) {
+        snprintf(arena.path, PATH_BUF_LEN, "%s/%s", h->tenants[0].dir, RT_JITTER_FILE);
+        jitter = rt_jitter_start(arena.path, h->rt.jitter_runs, &jitter_pid);
+    }
+
+    if (h->rt.enabled) {
+        rt_prefault(arena.event_buf, sizeof (arena.event_buf));
+        rt_enter(&h->rt);
+        /* from here on, nothing between read() and IO_write() may block on logging */
+        lws_log_defer(1);
+    }
+
+    if (jitter)
+        jitter->armed = 1;
+
+    /* wait for the all-off signal, the control socket and the event directory,
+     * all-off always goes first */
+    /* fixed slots, poll() skips the ones with fd -1 : all-off pipe, inotify,
+     * control socket, then the control clients waiting for their command */
+    struct pollfd pfd[3 + CONTROL_MAX_CLIENTS];
+    struct pollfd *clients = &pfd[3];
+    int npfd = 3 + CONTROL_MAX_CLIENTS;
+    for (int p = 0; p < npfd; p++) {
+        pfd[p].fd = -1;
+        pfd[p].events = POLLIN;
+    }
+    pfd[0].fd = all_off_pipe[0];
+    pfd[1].fd = fd;
+    pfd[2].fd = ctl;
+
+    int timeout = h->mem_report_secs ? h->mem_report_secs * 1000 : -1;
+    uint64_t next_mem_report = 0;
+    uint64_t next_reconnect = 0;
+    mem_startup_done();
 
     while (1) {
+        /* a lost board is retried on a timer, changes meanwhile stay in active_relays */
+        int wait = timeout;
+        if (!h->dev.device_open && (wait < 0 || wait > DEVICE_RETRY_MS))
+            wait = DEVICE_RETRY_MS;
+        for (int c = 0; c < CONTROL_MAX_CLIENTS; c++)
+            if (clients[c].fd >= 0 && (wait < 0 || wait > CONTROL_TIMEOUT_MS))
+                wait = CONTROL_TIMEOUT_MS;
+
+        int ready = poll(pfd, npfd, wait);
+        int poll_errno = errno;
+        uint64_t t_intake = rt_now_ns();
+
+        all_off_check_signal(h);
+
+        if (h->dev.device_open)
+            next_reconnect = 0;
+        else if (0 == next_reconnect)
+            next_reconnect = t_intake + DEVICE_RETRY_MS * 1000000ull;
+        else if (t_intake >= next_reconnect)
+            next_reconnect = device_reconnect(h) ? t_intake + DEVICE_RETRY_MS * 1000000ull : 0;
+
+        if (h->mem_report_secs && t_intake >= next_mem_report) {
+            mem_report();
+            next_mem_report = t_intake + h->mem_report_secs * 1000000000ull;
+        }
+
+        /* control clients : read the ones with a command, drop the ones too slow to send it */
+        for (int c = 0; c < CONTROL_MAX_CLIENTS; c++) {
+            if (clients[c].fd < 0)
+                continue;
+            if (ready > 0 && clients[c].revents)
+                control_command(h, &clients[c], t_intake);
+            else if (t_intake - arena.client_since[c] > CONTROL_TIMEOUT_MS * 1000000ull) {
+                close(clients[c].fd);
+                clients[c].fd = -1;
+            }
+        }
+        if (ready > 0 && (pfd[2].revents & POLLIN))
+            control_client_add(ctl, clients, t_intake);
+
+        if (ready <= 0) {
+            if (ready < 0 && poll_errno != EINTR)
+                lwsl_err("poll() failed : %s\n", strerror(poll_errno));
+            lws_log_flush();
+            continue;
+        }
+
+        if (!(pfd[1].revents & POLLIN)) {
+            lws_log_flush();
+            continue;
+        }
+
+        /* read to determine the event change happens on “/tmp” directory. */
         length = read(fd, buffer, EVENT_BUF_LEN);
 
         /*checking for error*/
@@ -454,13 +790,20 @@ run_as_daemon(ios_handle_t *h)
         }
 
         int i = 0;
+        uint32_t touched = 0; /* tenants with accepted changes in this batch */
 
         /*actually read return the list of change events happens. 
-         * Here, read the change event one by one and process it accordingly.*/
+         * Here, read the change event one by one and process it accordingly.
+         * Changes from all directories end up in one frame.*/
         while (i < length) {
             struct inotify_event *event = (struct inotify_event *) &buffer[i];
+            int t = (event->wd > 0 && event->wd < IOS_WD_TABLE) ? arena.wd_tenant[event->wd] - 1 : -1;
+            ios_tenant_t *tenant = (t >= 0) ? &h->tenants[t] : NULL;
 
-            if (event->len) {
+            if (tenant && (event->mask & IN_IGNORED)) {
+                lwsl_warn("%s : no longer watched\n", tenant->dir);
+                arena.wd_tenant[event->wd] = 0;
+            } else if (tenant && event->len) {
 
                 if (event->mask & IN_CREATE) {
                     if (event->mask & IN_ISDIR) {
@@ -468,11 +811,13 @@ run_as_daemon(ios_handle_t *h)
                     } else {
                         lwsl_debug("New file %s created.\n", event->name);
                         /* check pattern */
-                        int pin = 0;
-                        if (sscanf(event->name, "D_OUT_%d", &pin)) {
-                            h->active_relays |= 1 << (pin - 1);
-                            lwsl_info("set pin=%d HIGH\n", pin);
-                            eventcounter++;
+                        if (0 == strcmp(event->name, ALL_OFF_FILE)) {
+                            if (!tenant->all_off_file)
+                                h->all_off_files++;
+                            tenant->all_off_file = 1;
+                            all_off_trigger(h, ALL_OFF_BY_FILE, "file", t_intake);
+                        } else if (tenant_set_relay(h, tenant, event->name, 1)) {
+                            touched |= 1u << t;
                         }
                     }
                 } else if (event->mask & IN_DELETE) {
@@ -481,30 +826,66 @@ run_as_daemon(ios_handle_t *h)
                     } else {
                         lwsl_debug("File %s deleted.\n", event->name);
                         /* check pattern */
-                        int pin = 0;
-                        if (sscanf(event->name, "D_OUT_%d", &pin)) {
-                            h->active_relays &= ~(1 << (pin - 1));
-
-                            lwsl_info("set pin=%d LOW\n", pin);
-                            eventcounter++;
+                        if (0 == strcmp(event->name, ALL_OFF_FILE)) {
+                            if (tenant->all_off_file)
+                                h->all_off_files--;
+                            tenant->all_off_file = 0;
+                            all_off_clear(h, ALL_OFF_BY_FILE, "file");
+                        } else if (tenant_set_relay(h, tenant, event->name, 0)) {
+                            touched |= 1u << t;
                         }
                     }
                 }
             }
             i += EVENT_SIZE + event->len;
         }
-        /* send the pins states to the IO board */
-        USB_write_IO(h);
+        /* send the pins states to the IO board, unless everything is held off */
+        if (!h->all_off_latched && IO_write(&h->dev, h->active_relays) && !h->dev.device_open)
+            lwsl_warn("board lost, relays 0x%02x are sent when it is back\n", h->active_relays);
+        all_off_check_signal(h);
+
+        uint64_t t_written = rt_now_ns();
+        rt_latency_add(&intake_latency, t_written - t_intake);
+        for (int t = 0; touched; t++, touched >>= 1)
+            if (touched & 1)
+                rt_latency_add(&h->tenants[t].latency, t_written - t_intake);
+        if (jitter && jitter->sent != jitter->done) {
+            rt_latency_add(&event_latency, t_written - jitter->stamp_ns);
+            jitter->done = jitter->sent;
+        }
+
+        /* frame is out, now the log lines may hit stderr/syslog */
+        lws_log_flush();
+
+        if (jitter && jitter->done >= h->rt.jitter_runs)
+            break;
+    }
 
+    /* hot path is over, the reports go straight out instead of through the fixed ring */
+    lws_log_defer(0);
+
+    if (jitter) {
+        rt_jitter_stop(jitter, jitter_pid);
+        rt_latency_report(&intake_latency, "intake-to-write");
+        rt_latency_report(&event_latency, "event-to-write");
+        tenant_report(h, -1);
     }
-    /*removing the “/tmp” directory from the watch list.*/
-    inotify_rm_watch(fd, wd);
+
+    for (int c = 0; c < CONTROL_MAX_CLIENTS; c++)
+        if (clients[c].fd >= 0)
+            close(clients[c].fd);
+    control_close(ctl, h->control_path);
+
+    /*removing the event directories from the watch list.*/
+    for (int t = 0; t < h->ntenants; t++)
+        if (h->tenants[t].wd >= 0)
+            inotify_rm_watch(fd, h->tenants[t].wd);
 
     /*closing the INOTIFY instance*/
     close(fd);
 
 
-    USB_close_device(h);
+    IO_close_device(&h->dev);
 
 
     return 0;
@@ -514,10 +895,14 @@ int
 main(int argc, char *argv[])
 {
 
-    ios_handle_t *h = calloc(1, sizeof (ios_handle_t));
+    mem_stack_paint();
+
+    ios_handle_t *h = &arena.handle;
+    h->dev.fd = -1;
     int rc = 0; // return value to shell
-    extern int log_level; //  default is 7
     lwsl_emit = lwsl_emit_stderr; // log to stderr until we change it
+    h->rt.priority = RT_DEFAULT_PRIORITY;
+    h->rt.cpu = -1;
 
     /* 
      * use old style getopt() to be compatible
@@ -527,7 +912,7 @@ main(int argc, char *argv[])
     opterr = 0;
     int c;
 
-    while ((c = getopt(argc, argv, "dhi:sm:z:")) != -1)
+    while ((c = getopt(argc, argv, "dhi:sm:z:RP:C:J:S:M:b:n:")) != -1)
         switch (c) {
 
         case 's':
@@ -538,7 +923,8 @@ main(int argc, char *argv[])
             h->run_as_daemon = 1;
             break;
         case 'i':
-            h->event_dir = strdup(optarg);
+            if (add_tenant(h, optarg))
+                abort();
             break;
         case 'h':
             fprintf(stderr, _helptext);
@@ -546,9 +932,9 @@ main(int argc, char *argv[])
             break;
         case 'm':
             /* device brand/protocol 0=ch341 1=elomax */
-            h->device_brand = atoi(optarg);
-            if (h->device_brand >= DEVICE_BRAND_LAST) {
-                fprintf(stderr, "devicebrand must be < %d, (ABACOM=0 or Elomax=1)\n", DEVICE_BRAND_LAST);
+            h->dev.device_brand = atoi(optarg);
+            if (h->dev.device_brand >= DEVICE_BRAND_LAST) {
+                fprintf(stderr, "devicebrand must be < %d, (ABACOM=0, Elomax=1 or hidraw=2)\n", DEVICE_BRAND_LAST);
                 abort();
             }
             break;
@@ -560,7 +946,39 @@ main(int argc, char *argv[])
                 fprintf(stderr, "valid levels : ERR = 1, WARN =2, NOTICE=4, INFO=8, DEBUG=16 OR together");
                 abort();
             }
-            lws_set_log_level(log_level, lwsl_emit_stderr);
+            lws_set_log_level(log_level, NULL);
+            break;
+        case 'R': /* real-time mode */
+            h->rt.enabled = 1;
+            break;
+        case 'P': /* SCHED_FIFO priority for real-time mode */
+            h->rt.priority = atoi(optarg);
+            if (h->rt.priority < 1 || h->rt.priority > 99) {
+                fprintf(stderr, "priority (-P %d) out of range 1..99\n", h->rt.priority);
+                abort();
+            }
+            break;
+        case 'C': /* pin to cpu in real-time mode */
+            h->rt.cpu = atoi(optarg);
+            break;
+        case 'S': /* control socket */
+            if (snprintf(h->control_path, sizeof (h->control_path), "%s", optarg) >= (int) sizeof (h->control_path)) {
+                fprintf(stderr, "control socket name too long (max %d)\n", (int) sizeof (h->control_path) - 1);
+                abort();
+            }
+            break;
+        case 'n': /* device node, hidraw or fake device for testing */
+            h->dev.node = optarg;
+            break;
+        case 'b': /* batch input, - = stdin */
+            h->batch_path = optarg;
+            break;
+        case 'M': /* memory footprint report */
+            h->mem_report_secs = atoi(optarg);
+            break;
+        case 'J': /* jitter self-test, implies -d */
+            h->rt.jitter_runs = strtoul(optarg, NULL, 0);
+            h->run_as_daemon = 1;
             break;
 
         default:
@@ -572,15 +990,16 @@ main(int argc, char *argv[])
 
     if (h->run_as_daemon) {
         /* we keep running until the end of time (or signal) */
-        if (0 == h->event_dir) {
+        if (0 == h->ntenants) {
             fprintf(stderr, "using /tmp as default event directory\n");
-            h->event_dir = strdup("/tmp");
+            add_tenant(h, "/tmp");
         }
         rc = run_as_daemon(h);
+    } else if (h->batch_path) {
+        rc = run_batch(h, h->batch_path);
     } else {
         rc = run_once(h, argc, argv);
     }
 
-    free(h);
     return rc;
 }
\ No newline at end of file
@@ -12,6 +12,62 @@
 extern "C" {
 #endif
 
+#include <stdint.h>
+#include <sys/types.h>
+#include "rt.h"
+#include "driver.h"
+
+#ifdef SMALL_FOOTPRINT
+#define PATH_BUF_LEN      256
+#else
+#define PATH_BUF_LEN      4096
+#endif
+
+#define IOS_MAX_TENANTS   8  /* event directories watched by one daemon */
+#define IOS_WD_TABLE      64 /* inotify watch descriptor -> tenant lookup */
+
+/* one event directory (-i) and the relays its files may switch */
+typedef struct ios_tenant
+{
+    char dir[PATH_BUF_LEN - 32]; // event directory, room left for file names
+    uint32_t relays; // relays owned by this directory, bit mask
+    int wd; // inotify watch descriptor
+    dev_t dev; // directory identity, the same directory twice is refused
+    ino_t ino;
+    int all_off_file; // D_ALL_OFF exists in dir
+    unsigned long events; // D_OUT_ changes accepted
+    unsigned long rejected; // D_OUT_ changes to relays owned by someone else
+    rt_latency_t latency; // event intake to frame written
+} ios_tenant_t;
+
+/* what latched all-off, each source is released on its own */
+#define ALL_OFF_BY_SIGNAL   0x01 /* SIGUSR2, released by the clear command */
+#define ALL_OFF_BY_SOCKET   0x02 /* off command, released by the clear command */
+#define ALL_OFF_BY_FILE     0x04 /* D_ALL_OFF, released when no directory holds it */
+
+/* the program : the board plus everything the daemon, batch and run once modes need */
+typedef struct
+{
+    ios_device_t dev; // the board, see driver.h
+    uint32_t active_relays; // bit mask requested
+
+    // int verbose; // verbose output to console
+    int use_syslog; // use syslog for logging instead of console
+    int run_as_daemon; // run as daemon, use /tmp/ID/D_OUT_99 inotify for control
+    ios_tenant_t tenants[IOS_MAX_TENANTS]; // where to listen for events, and who owns which relay
+    int ntenants;
+    uint64_t started_ns; // daemon start, for event rates
+    rt_config_t rt; // real-time mode and jitter self-test settings
+
+    /* emergency all-off */
+    int all_off_latched; // ALL_OFF_BY_ bits, relays forced off while any is set
+    int all_off_files; // event dirs holding D_ALL_OFF
+    rt_latency_t all_off_latency; // trigger to confirmed off
+    char control_path[PATH_BUF_LEN]; // control socket, empty = none
+    const char *batch_path; // -b : batch input file, "-" = stdin, NULL = no batch
+    int mem_report_secs; // -M : log memory footprint every n seconds, 0 = off
+} ios_handle_t;
+
     const char _helptext[] = "\nName : switch_relay - switch relays on Abacom or Elomax board on or off"
             "\nCan be run once, to set some relays or"
             "\ncan run as a directory monitor using inotify, will switch relays when files are created or removed"
@@ -20,16 +76,26 @@ extern "C" {
             "\noptions:"
             "\n -s : use syslog for logging instead of stderr"
             "\n -d : keep running (as a daemon) does not fork (use something like supervisord)"
-            "\n -i <directory_name> : use event listing on this directory instead of /tmp"
+            "\n -i <directory_name>[:relays] : use event listing on this directory instead of /tmp, repeat for more directories (max 8),"
+            "\n    relays (like 1-4 or 1,3,5-8) limits the relays files in this directory may switch, default all"
             "\n -h : show help text"
-            "\n -m <0|1> : use Abacom=0 (default) or Elmax=1 protocol and device"
+            "\n -m <0|1|2> : use Abacom=0 (default), Elmax=1 or hidraw=2 (16c0:05df USBRelay boards) protocol and device"
             "\n -z loglevel : set loglevel (default=7) valid levels : ERR = 1, WARN =2, NOTICE=4, INFO=8, DEBUG=16 OR together"
+            "\n -R : real-time mode, SCHED_FIFO, locked memory, no log output between event and USB write"
+            "\n -P priority : SCHED_FIFO priority for -R (1..99, default=50)"
+            "\n -C cpu : pin to this cpu for -R (default: no pinning)"
+            "\n -J count : jitter self-test, toggle D_OUT_JITTER count times and report event-to-write latency, implies -d"
+            "\n -S socket_path : control socket, commands : off | clear | status | stats"
+            "\n -M seconds : log memory footprint (rss, stack high-water, heap growth) every n seconds"
+            "\n -b file : batch mode, keep the device open and run every line of file (- = stdin), see below"
+            "\n -n node : use this device node, a /dev/hidrawN for -m 2, or a plain file as fake board (raw transfers are written to it)"
             "\n"
             "\n"
             "\nUsage example:"
             "\n $ switch_relay  : switch all relays off"
             "\n $ switch_relay 4 : switch all relays off, but switch relay 4 on"
             "\n $ switch_relay -s -d -z 31 : use syslog, keep running, use maximum logging"
+            "\n $ switch_relay -R -P 80 -C 1 -J 1000 : real-time mode on cpu 1, report latency of 1000 events"
             "\n"
             "\nWhen using (-d) the program will monitor /tmp/ for creation or removal of files"
             "\n /tmp/D_OUT_1 /tmp/D_OUT_2 .. /tmp_D_OUT_8"
@@ -38,6 +104,30 @@ extern "C" {
             "\nexample :"
             "\n $ touch /tmp/D_OUT_1 : will active relay no 1"
             "\n $ rm /tmp/D_OUT_1    : will switch relay off again"
+            "\n a board that is lost is opened again every second, then the relays are set to what the files say"
+            "\n"
+            "\nSeveral event directories (-d) : one daemon, one frame for changes from all of them"
+            "\n $ switch_relay -d -S /run/relay.sock -i /run/app1:1-4 -i /run/app2:5-8"
+            "\n   /run/app1/D_OUT_6 is ignored and counted as rejected, D_ALL_OFF in any directory switches all off"
+            "\n $ echo stats | socat - UNIX-CONNECT:/run/relay.sock : events, rejected, rate and latency per directory"
+            "\n"
+            "\nEmergency all-off (-d) : every relay off at once, latched until cleared"
+            "\n $ kill -USR2 <pid>        : all off"
+            "\n $ touch /tmp/D_ALL_OFF    : all off, stays off while the file exists"
+            "\n $ rm /tmp/D_ALL_OFF       : releases the file, relays follow the D_OUT_ files again"
+            "\n $ echo off | socat - UNIX-CONNECT:<socket_path>   (off, clear or status)"
+            "\n an all-off by signal or off command is released only by the clear command,"
+            "\n removing a file never releases it, clear never releases a file that still exists"
+            "\n"
+            "\nBatch mode (-b) : one step per line, frames are written back to back"
+            "\n <mask> [delay_ms]  : set outputs to mask (decimal or 0x hex), then wait"
+            "\n on <relay>...      : switch these relays on, leave the others"
+            "\n off <relay>...     : switch these relays off, leave the others"
+            "\n sleep <ms>         : wait"
+            "\n $ seq 0 255 | switch_relay -b - : count through all patterns, report updates/s and step latency"
+            "\n stops at the first hardware error (exit code 4) and reports the step number"
+            "\n every frame is a synchronous write, the rate is bounded by the round trips of one frame,"
+            "\n frames are not queued ahead; lines are at most 254 characters, a longer comment is cut off"
             "\n\n";
 
 #ifdef	__cplusplus
@@ -0,0 +1,128 @@
+/*
+ * Memory footprint accounting for the relay daemon
+ * see mem.h
+ *
+ * Nothing in here allocates, /proc is read with plain read()
+ * so the report itself does not disturb what it measures.
+ */
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "logging.h"
+#include "mem.h"
+
+static uintptr_t paint_low; /* lowest painted stack address */
+static size_t stack_kept; /* stack used before the painted area was painted again */
+static uintptr_t brk_start; /* program break when startup was done */
+static unsigned long allocs_start; /* allocations counted when startup was done */
+static unsigned long heap_allocs; /* only counted when linked with --wrap=malloc */
+
+#ifdef MEM_WRAP_MALLOC
+/* make small links with -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc */
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t nmemb, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+
+void *
+__wrap_malloc(size_t size)
+{
+    heap_allocs++;
+    return __real_malloc(size);
+}
+
+void *
+__wrap_calloc(size_t nmemb, size_t size)
+{
+    heap_allocs++;
+    return __real_calloc(nmemb, size);
+}
+
+void *
+__wrap_realloc(void *ptr, size_t size)
+{
+    heap_allocs++;
+    return __real_realloc(ptr, size);
+}
+#endif
+
+/* call first thing in main(), the painted area is what the program may use below it */
+__attribute__((noinline)) void
+mem_stack_paint(void)
+{
+    unsigned char area[MEM_STACK_PAINT];
+
+    memset(area, MEM_PAINT_BYTE, sizeof (area));
+    __asm__ volatile("" : : "r"(area) : "memory");
+    paint_low = (uintptr_t) area;
+}
+
+static size_t
+mem_stack_used(void)
+{
+    const volatile unsigned char *p = (const volatile unsigned char *) paint_low;
+    size_t untouched = 0;
+
+    if (!paint_low)
+        return 0;
+    while (untouched < MEM_STACK_PAINT && MEM_PAINT_BYTE == p[untouched])
+        untouched++;
+    size_t used = MEM_STACK_PAINT - untouched;
+    return (used > stack_kept) ? used : stack_kept;
+}
+
+/* call before the painted stack is overwritten with the paint byte again
+ * (rt_prefault), the high-water mark so far is kept */
+void
+mem_stack_keep(void)
+{
+    stack_kept = mem_stack_used();
+}
+
+void
+mem_startup_done(void)
+{
+    brk_start = (uintptr_t) sbrk(0);
+    allocs_start = heap_allocs;
+}
+
+/* value in kB of a "Name:   1234 kB" line, 0 if not found */
+static unsigned long
+mem_status_kb(const char *status, const char *name)
+{
+    const char *p = strstr(status, name);
+
+    return p ? strtoul(p + strlen(name), NULL, 10) : 0;
+}
+
+void
+mem_report(void)
+{
+    static char status[2048];
+    unsigned long rss = 0, hwm = 0;
+
+    int fd = open("/proc/self/status", O_RDONLY);
+    if (fd >= 0) {
+        ssize_t n = read(fd, status, sizeof (status) - 1);
+        close(fd);
+        if (n > 0) {
+            status[n] = '\0';
+            rss = mem_status_kb(status, "VmRSS:");
+            hwm = mem_status_kb(status, "VmHWM:");
+        }
+    }
+
+    long brk_growth = (long) ((uintptr_t) sbrk(0) - brk_start);
+
+#ifdef MEM_WRAP_MALLOC
+    lwsl_notice("memory: rss=%lukB hwm=%lukB stack=%zu/%dB brk+=%ldB allocs+=%lu\n",
+                rss, hwm, mem_stack_used(), MEM_STACK_PAINT, brk_growth,
+                heap_allocs - allocs_start);
+#else
+    (void) allocs_start;
+    lwsl_notice("memory: rss=%lukB hwm=%lukB stack=%zu/%dB brk+=%ldB\n",
+                rss, hwm, mem_stack_used(), MEM_STACK_PAINT, brk_growth);
+#endif
+}
@@ -0,0 +1,33 @@
+/*
+ * File:   mem.h
+ * Memory footprint accounting for the relay daemon (-M)
+ *
+ * resident set size, stack high-water mark (painted stack)
+ * and heap growth after startup.
+ */
+
+#ifndef MEM_H
+#define	MEM_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#ifdef SMALL_FOOTPRINT
+#define MEM_STACK_PAINT (16 * 1024) /* bytes of stack painted below main() */
+#else
+#define MEM_STACK_PAINT (64 * 1024)
+#endif
+
+#define MEM_PAINT_BYTE 0xA5
+
+void mem_stack_paint(void);
+void mem_stack_keep(void);
+void mem_startup_done(void);
+void mem_report(void);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* MEM_H */
@@ -0,0 +1,210 @@
+/*
+ * Real-time latency mode for the relay daemon
+ * see rt.h
+ *
+ * Everything that can page fault, allocate or reschedule us is done here,
+ * once, before the daemon enters its event loop.
+ */
+
+#define _GNU_SOURCE /* sched_setaffinity() */
+#include <errno.h>
+#include <fcntl.h>
+#include <malloc.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include "logging.h"
+#include "rt.h"
+#include "mem.h"
+
+#define RT_JITTER_PERIOD_US 10000 /* pause between self-test events */
+#define RT_JITTER_TIMEOUT_NS 1000000000ull /* give up waiting for the daemon */
+
+void
+rt_prefault(void *buf, size_t len)
+{
+    /* touch every page so it is resident before mlockall() pins it */
+    volatile unsigned char *p = buf;
+    long pagesize = sysconf(_SC_PAGESIZE);
+
+    for (size_t i = 0; i < len; i += (size_t) pagesize)
+        p[i] = p[i];
+}
+
+static void
+rt_prefault_stack(void)
+{
+    unsigned char dummy[RT_PREFAULT_STACK];
+
+    /* this paints over the stack used so far : keep its high-water mark first,
+     * then write the paint byte so -M only counts what is used after this */
+    mem_stack_keep();
+    memset(dummy, MEM_PAINT_BYTE, sizeof (dummy));
+    rt_prefault(dummy, sizeof (dummy));
+}
+
+int
+rt_enter(const rt_config_t *cfg)
+{
+    int failed = 0;
+
+    /* keep freed memory mapped, so libusb's own small allocations
+     * are served from locked pages and never reach the kernel */
+    mallopt(M_TRIM_THRESHOLD, -1);
+    mallopt(M_MMAP_MAX, 0);
+
+    void *heap = malloc(RT_PREFAULT_HEAP);
+    if (heap) {
+        memset(heap, 0, RT_PREFAULT_HEAP);
+        free(heap);
+    }
+
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+        lwsl_warn("mlockall() failed : %s\n", strerror(errno));
+        failed++;
+    }
+
+    rt_prefault_stack();
+
+    if (cfg->cpu >= 0) {
+        cpu_set_t set;
+
+        CPU_ZERO(&set);
+        CPU_SET(cfg->cpu, &set);
+        if (sched_setaffinity(0, sizeof (set), &set) != 0) {
+            lwsl_warn("sched_setaffinity(cpu=%d) failed : %s\n", cfg->cpu, strerror(errno));
+            failed++;
+        }
+    }
+
+    struct sched_param sp = {0};
+    sp.sched_priority = cfg->priority;
+    if (sched_setscheduler(0, SCHED_FIFO, &sp) != 0) {
+        lwsl_warn("sched_setscheduler(SCHED_FIFO, %d) failed : %s\n", cfg->priority, strerror(errno));
+        failed++;
+    }
+
+    lwsl_notice("real-time mode: prio=%d cpu=%d failures=%d\n", cfg->priority, cfg->cpu, failed);
+
+    return failed ? -1 : 0;
+}
+
+void
+rt_latency_reset(rt_latency_t *l)
+{
+    memset(l, 0, sizeof (*l));
+    l->min_ns = UINT64_MAX;
+}
+
+void
+rt_latency_add(rt_latency_t *l, uint64_t ns)
+{
+    uint64_t us = ns / 1000;
+    int bucket = 0;
+
+    while (us > 1 && bucket < RT_HIST_BUCKETS - 1) {
+        us >>= 1;
+        bucket++;
+    }
+
+    l->count++;
+    l->sum_ns += ns;
+    if (ns < l->min_ns)
+        l->min_ns = ns;
+    if (ns > l->max_ns)
+        l->max_ns = ns;
+    l->hist[bucket]++;
+}
+
+void
+rt_latency_report(const rt_latency_t *l, const char *what)
+{
+    if (0 == l->count) {
+        lwsl_notice("%s : no samples\n", what);
+        return;
+    }
+
+    lwsl_notice("%s : n=%llu min=%lluus avg=%lluus max=%lluus\n", what,
+                (unsigned long long) l->count,
+                (unsigned long long) (l->min_ns / 1000),
+                (unsigned long long) (l->sum_ns / l->count / 1000),
+                (unsigned long long) (l->max_ns / 1000));
+
+    for (int i = 0; i < RT_HIST_BUCKETS; i++)
+        if (l->hist[i])
+            lwsl_notice("%s : < %8luus %u\n", what, 2ul << i, l->hist[i]);
+}
+
+static void
+rt_jitter_child(rt_jitter_t *j, const char *path, unsigned long runs)
+{
+    /* load generator runs at normal priority, it must not compete with the daemon */
+    struct sched_param sp = {0};
+    sched_setscheduler(0, SCHED_OTHER, &sp);
+
+    while (!j->armed)
+        usleep(1000);
+
+    for (unsigned long n = 0; n < runs; n++) {
+        j->stamp_ns = rt_now_ns();
+        __sync_synchronize();
+        j->sent = n + 1;
+
+        if (n & 1) {
+            unlink(path);
+        } else {
+            int fd = open(path, O_CREAT | O_WRONLY, 0644);
+            if (fd >= 0)
+                close(fd);
+        }
+
+        /* lock step : wait until the daemon has written the frame */
+        uint64_t deadline = rt_now_ns() + RT_JITTER_TIMEOUT_NS;
+        while (j->done != j->sent && rt_now_ns() < deadline)
+            usleep(100);
+
+        usleep(RT_JITTER_PERIOD_US);
+    }
+    unlink(path);
+}
+
+rt_jitter_t *
+rt_jitter_start(const char *path, unsigned long runs, pid_t *child)
+{
+    rt_jitter_t *j = mmap(NULL, sizeof (*j), PROT_READ | PROT_WRITE,
+                          MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+
+    if (MAP_FAILED == j) {
+        lwsl_err("jitter self-test: mmap() failed : %s\n", strerror(errno));
+        return NULL;
+    }
+    memset((void *) j, 0, sizeof (*j));
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        lwsl_err("jitter self-test: fork() failed : %s\n", strerror(errno));
+        munmap(j, sizeof (*j));
+        return NULL;
+    }
+    if (0 == pid) {
+        rt_jitter_child(j, path, runs);
+        _exit(0);
+    }
+
+    lwsl_notice("jitter self-test: %lu events on %s, child pid=%d\n", runs, path, pid);
+    *child = pid;
+    return j;
+}
+
+void
+rt_jitter_stop(rt_jitter_t *j, pid_t child)
+{
+    if (NULL == j)
+        return;
+    waitpid(child, NULL, 0);
+    munmap(j, sizeof (*j));
+}
@@ -0,0 +1,83 @@
+/*
+ * File:   rt.h
+ * Real-time latency mode for the relay daemon (-R) and the jitter self-test (-J)
+ *
+ * SCHED_FIFO priority, CPU pinning, locked and prefaulted memory,
+ * latency statistics between event intake and USB write completion.
+ */
+
+#ifndef RT_H
+#define	RT_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <sys/types.h>
+#include <time.h>
+
+#define RT_DEFAULT_PRIORITY 50
+#ifdef SMALL_FOOTPRINT
+#define RT_PREFAULT_STACK   (32 * 1024) /* bytes of stack touched before locking */
+#define RT_PREFAULT_HEAP    (32 * 1024) /* bytes of heap kept mapped for libusb */
+#else
+#define RT_PREFAULT_STACK   (256 * 1024)
+#define RT_PREFAULT_HEAP    (256 * 1024)
+#endif
+#define RT_HIST_BUCKETS     24           /* log2 microsecond buckets, 1us .. 8s */
+
+/* file toggled by the jitter self-test, does not match D_OUT_%d */
+#define RT_JITTER_FILE "D_OUT_JITTER"
+
+typedef struct rt_config
+{
+    int enabled; // -R : switch to SCHED_FIFO and lock memory
+    int priority; // -P : SCHED_FIFO priority (1..99)
+    int cpu; // -C : cpu to pin to, -1 = do not pin
+    unsigned long jitter_runs; // -J : number of self-test events, 0 = no self-test
+} rt_config_t;
+
+typedef struct rt_latency
+{
+    uint64_t count;
+    uint64_t min_ns;
+    uint64_t max_ns;
+    uint64_t sum_ns;
+    uint32_t hist[RT_HIST_BUCKETS];
+} rt_latency_t;
+
+/* shared between the daemon and the self-test child (MAP_SHARED page) */
+typedef struct rt_jitter
+{
+    volatile int armed; // set by daemon when the watch is active
+    volatile unsigned long sent; // events generated by the child
+    volatile unsigned long done; // events acknowledged by the daemon
+    volatile uint64_t stamp_ns; // time the child touched the file
+} rt_jitter_t;
+
+static inline uint64_t
+rt_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ull + (uint64_t) ts.tv_nsec;
+}
+
+int rt_enter(const rt_config_t *cfg);
+void rt_prefault(void *buf, size_t len);
+
+void rt_latency_reset(rt_latency_t *l);
+void rt_latency_add(rt_latency_t *l, uint64_t ns);
+void rt_latency_report(const rt_latency_t *l, const char *what);
+
+/* path : RT_JITTER_FILE in the event directory, the caller's buffer, the child keeps its copy */
+rt_jitter_t *rt_jitter_start(const char *path, unsigned long runs, pid_t *child);
+void rt_jitter_stop(rt_jitter_t *j, pid_t child);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* RT_H */